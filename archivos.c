@@ -1,122 +1,447 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
 #include "util.h"
 #include "lista.h"
 #include "lectura.h"
-#include "parser.h"
+#include "csv.h"
 #include "votante_partido.h"
 
 
 typedef struct maquina_votacion maquina_votacion_t;
 
 /************ PROTOTYPES ************/
-lista_t* cargar_csv_en_lista(maquina_votacion_t* maquina, const char* nombre, bool (*func)(fila_csv_t*, lista_t*, size_t) );
-bool enlistar_partido(fila_csv_t* fila, lista_t* lista, size_t columnas);
-bool enlistar_votante(fila_csv_t* fila, lista_t* lista, size_t columnas);
+bool cargar_csv(const char* nombre, visitar_registro_t func, void* extra);
+lista_t* cargar_listas(const char* nombre, cargos_t* cargos);
+void cargos_destruir(cargos_t* cargos);
+uint64_t* cargar_padron(const char* nombre, size_t* cantidad);
+uint64_t* cargar_padrones(const char* nombres, size_t* cantidad);
+bool padrones_legibles(const char* nombres);
+bool enlistar_partido(const campo_csv_t* campos, size_t cantidad, void* carga);
+bool enlistar_documento(const campo_csv_t* campos, size_t cantidad, void* claves);
+uint64_t firma_archivo(const char* nombre);
 /************************************/
 
-lista_t* cargar_csv_en_lista(maquina_votacion_t* maquina, const char* nombre, bool (*func)(fila_csv_t*, lista_t*, size_t) ) {
+/* Arreglo dinamico de claves de documento, para cargar el padron */
+typedef struct arreglo_claves {
+    uint64_t* datos;
+    size_t cantidad;
+    size_t capacidad;
+} arreglo_claves_t;
+
+/* Estado del recorrido de cargar_csv: pasa el encabezado a func_encabezado
+ (si no es NULL) y el resto a func */
+typedef struct carga_csv {
+    visitar_registro_t func_encabezado;
+    visitar_registro_t func;
+    void* extra;
+    bool encabezado;
+} carga_csv_t;
+
+/* Uno de los padrones que se unen, cargado y ordenado en su propio hilo */
+typedef struct padron_parcial {
+    char* nombre;
+    // Salida de los errores: la del hilo que pidio la carga
+    FILE* salida;
+    uint64_t* claves;
+    size_t cantidad;
+    // Filas descartadas por repetir una clave del mismo archivo
+    size_t repetidas;
+    pthread_t hilo;
+    bool hilo_creado;
+} padron_parcial_t;
+
+// Separador de los archivos en la lista de padrones
+#define PADRONES_SEPARADOR ","
+// Votantes repetidos entre archivos que se informan uno por uno
+#define PADRONES_CONFLICTOS_MOSTRADOS 10
+
+/* Partidos que se estan cargando, que al final pasan de una vez a la lista,
+ y los cargos leidos del encabezado */
+typedef struct carga_listas {
+    void** partidos;
+    size_t cantidad;
+    size_t capacidad;
+    cargos_t* cargos;
+} carga_listas_t;
+
+static bool visitar_fila(const campo_csv_t* campos, size_t cantidad, void* dato) {
+    carga_csv_t* carga = dato;
+
+    if(carga->encabezado)
+    {
+        carga->encabezado = false;
+        return !carga->func_encabezado || carga->func_encabezado(campos, cantidad, carga->extra);
+    }
+    return carga->func(campos, cantidad, carga->extra);
+}
+
+/* Lee el archivo csv pasando el encabezado a func_encabezado y cada fila a func */
+static bool recorrer_csv(const char* nombre, visitar_registro_t func_encabezado, visitar_registro_t func, void* extra) {
+
+    csv_t* csv = csv_abrir(nombre, ',');
+    if(!csv) return error_manager(LECTURA);
 
-    FILE* f = fopen(nombre,"r");
-    if(!f) { error_manager(LECTURA); return NULL; }
+    carga_csv_t carga = { func_encabezado, func, extra, true };
+    bool insertado = csv_recorrer(csv, visitar_fila, &carga);
 
-    char* linea = leer_linea(f);
-    if(!linea) { error_manager(OTRO); return NULL; }
+    // Un error de lectura a mitad del archivo no debe pasar por fin de archivo.
+    if(csv_fallo(csv)) insertado = error_manager(LECTURA);
+    else if(carga.encabezado) insertado = error_manager(OTRO); // Archivo vacio
+    csv_cerrar(csv);
 
-    // Saltear primer linea.
-    free(linea);
-    linea = leer_linea(f);
+    return insertado;
+}
 
-    lista_t* lista = lista_crear();
-    if(!lista) { error_manager(OTRO); return NULL; }
+/*
+ Lee un archivo csv salteando la primer linea (encabezado) y llama a func con
+ cada fila. Los campos solo son validos durante el llamado: func copia lo que
+ necesite conservar.
+ Post: Devuelve false (informando el error) si no se pudo leer el archivo o func fallo.
+*/
+bool cargar_csv(const char* nombre, visitar_registro_t func, void* extra) {
+    return recorrer_csv(nombre, NULL, func, extra);
+}
+
+/*
+ Toma los nombres de los cargos de las columnas del encabezado de listas que
+ siguen a numero y nombre del partido.
+ Post: Devuelve false si no hay entre 1 y CARGOS_MAXIMO cargos o en caso de error.
+*/
+static bool leer_cargos(const campo_csv_t* campos, size_t cantidad, void* extra) {
+    cargos_t* cargos = ((carga_listas_t*) extra)->cargos;
 
-    size_t columnas = obtener_cantidad_columnas(linea, ',');
+    if(cantidad < 3 || cantidad - 2 > CARGOS_MAXIMO) return error_manager(LECTURA);
 
-    while(linea)
+    for(size_t i=2;i<cantidad;i++)
     {
-        fila_csv_t* fila = parsear_linea_csv(linea, columnas, false);
-        free(linea); // No se usa mas, se libera.
+        cargos->nombres[cargos->cantidad] = copiar_clave(campos[i].dato);
+        if(!cargos->nombres[cargos->cantidad]) return error_manager(OTRO);
+        cargos->cantidad++;
+    }
+    return true;
+}
+
+/* Libera los nombres de los cargos y deja la cantidad en cero */
+void cargos_destruir(cargos_t* cargos) {
+    for(size_t i=0;i<cargos->cantidad;i++)
+        free(cargos->nombres[i]);
+    cargos->cantidad = 0;
+}
+
+/*
+ Carga las listas de partidos y, de su encabezado, los cargos que se eligen.
+ Post: Devuelve NULL (informando el error y dejando cargos vacio) si no se pudo cargar.
+*/
+lista_t* cargar_listas(const char* nombre, cargos_t* cargos) {
+
+    cargos->cantidad = 0;
+    carga_listas_t carga = { NULL, 0, 0, cargos };
+    lista_t* lista = NULL;
+
+    if(recorrer_csv(nombre, leer_cargos, enlistar_partido, &carga))
+    {
+        lista = lista_crear_desde(carga.partidos, carga.cantidad);
+        if(!lista) error_manager(OTRO);
+    }
+
+    if(!lista)
+    {
+        for(size_t i=0;i<carga.cantidad;i++) destruir_partido(carga.partidos[i]);
+        cargos_destruir(cargos);
+    }
+    free(carga.partidos);
+    return lista;
+}
+
+/*
+ Carga las claves de documento de los votantes del padron, en el orden del archivo.
+ Post: Devuelve NULL (informando el error) si no se pudo cargar.
+*/
+uint64_t* cargar_padron(const char* nombre, size_t* cantidad) {
+    arreglo_claves_t claves = { NULL, 0, 0 };
+
+    if(!cargar_csv(nombre, enlistar_documento, &claves))
+    {
+        free(claves.datos);
+        return NULL;
+    }
+
+    // Un padron vacio igual devuelve un arreglo valido.
+    if(!claves.datos && !(claves.datos = malloc(sizeof(uint64_t)))) { error_manager(OTRO); return NULL; }
+
+    *cantidad = claves.cantidad;
+    return claves.datos;
+}
+
+static int comparar_claves(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*) a, y = *(const uint64_t*) b;
+    return (x > y) - (x < y);
+}
+
+/* Carga uno de los padrones, lo ordena y saca las claves repetidas */
+static void* cargar_padron_parcial(void* dato) {
+    padron_parcial_t* parcial = dato;
+    salida_establecer(parcial->salida);
+
+    parcial->claves = cargar_padron(parcial->nombre, &parcial->cantidad);
+    if(!parcial->claves) return NULL;
+
+    qsort(parcial->claves, parcial->cantidad, sizeof(uint64_t), comparar_claves);
 
-        if(!fila)
+    size_t distintas = 0;
+    for(size_t i=0;i<parcial->cantidad;i++)
+        if(!distintas || parcial->claves[i] != parcial->claves[distintas-1])
+            parcial->claves[distintas++] = parcial->claves[i];
+    parcial->repetidas = parcial->cantidad - distintas;
+    parcial->cantidad = distintas;
+    return NULL;
+}
+
+/*
+ Une los padrones ya ordenados en claves, sin repetidos, e informa en stderr
+ los votantes que estan en mas de un archivo. Mezcla de a k: para cada clave
+ se busca la menor entre los primeros de cada archivo, que son pocos.
+*/
+static size_t unir_padrones(padron_parcial_t* parciales, size_t cantidad, uint64_t* claves) {
+    size_t* posiciones = calloc(cantidad, sizeof(size_t));
+    if(!posiciones) return SIZE_MAX;
+
+    size_t unidas = 0, conflictos = 0;
+    while(true)
+    {
+        size_t menor = SIZE_MAX;
+        for(size_t i=0;i<cantidad;i++)
+            if(posiciones[i] < parciales[i].cantidad && (menor == SIZE_MAX || parciales[i].claves[posiciones[i]] < parciales[menor].claves[posiciones[menor]]))
+                menor = i;
+        if(menor == SIZE_MAX) break;
+
+        uint64_t clave = parciales[menor].claves[posiciones[menor]++];
+        claves[unidas++] = clave;
+
+        // Los demas archivos con la misma clave la tienen primera. El votante
+        // se informa una vez, con todos los archivos en que esta.
+        bool repetida = false, mostrada = conflictos < PADRONES_CONFLICTOS_MOSTRADOS;
+        for(size_t i=menor+1;i<cantidad;i++)
         {
-            // Leer proxima linea
-            linea = leer_linea(f);
-            continue;
+            if(posiciones[i] >= parciales[i].cantidad || parciales[i].claves[posiciones[i]] != clave) continue;
+            posiciones[i]++;
+            if(mostrada && !repetida)
+                fprintf(stderr, "Padron: %s %llu en %s", documento_clave_tipo(clave),
+                    (unsigned long long) documento_clave_numero(clave), parciales[menor].nombre);
+            if(mostrada) fprintf(stderr, " y en %s", parciales[i].nombre);
+            repetida = true;
         }
+        if(repetida && mostrada) fprintf(stderr, "\n");
+        conflictos += repetida;
+    }
+    free(posiciones);
 
-        bool insertado = func(fila, lista, columnas);
+    if(conflictos)
+        fprintf(stderr, "Padron: %zu votantes en mas de un archivo\n", conflictos);
+    return unidas;
+}
 
-        destruir_fila_csv(fila, false); // No se usa mas, se libera.
-        if(!insertado) break;
+bool padrones_legibles(const char* nombres) {
+    char* copia = copiar_clave(nombres);
+    if(!copia) return false;
 
-        // Leer proxima linea
-        linea = leer_linea(f);
+    bool legibles = true;
+    char* resto;
+    for(char* nombre=strtok_r(copia, PADRONES_SEPARADOR, &resto);nombre && legibles;nombre=strtok_r(NULL, PADRONES_SEPARADOR, &resto))
+    {
+        FILE* archivo = fopen(nombre, "r");
+        if(archivo) fclose(archivo);
+        else legibles = false;
     }
-    free(linea);
-    fclose(f);
+    free(copia);
+    return legibles;
+}
 
-    return lista;
+/*
+ Carga varios padrones, separados por comas en nombres, cada uno en su hilo,
+ y los une en un solo arreglo de claves ordenado y sin repetidos. Informa en
+ stderr las repeticiones dentro de cada archivo y entre archivos.
+*/
+uint64_t* cargar_padrones(const char* nombres, size_t* cantidad) {
+    // Los archivos que faltan se informan una sola vez, antes de empezar.
+    if(!padrones_legibles(nombres)) { error_manager(LECTURA); return NULL; }
+
+    char* copia = copiar_clave(nombres);
+    size_t archivos = 1;
+    for(const char* c=nombres;*c;c++) if(*c == PADRONES_SEPARADOR[0]) archivos++;
+    padron_parcial_t* parciales = copia ? calloc(archivos, sizeof(padron_parcial_t)) : NULL;
+    if(!parciales) { free(copia); error_manager(OTRO); return NULL; }
+
+    char* resto;
+    archivos = 0;
+    for(char* nombre=strtok_r(copia, PADRONES_SEPARADOR, &resto);nombre;nombre=strtok_r(NULL, PADRONES_SEPARADOR, &resto))
+    {
+        padron_parcial_t* parcial = &parciales[archivos++];
+        parcial->nombre = nombre;
+        parcial->salida = salida_actual();
+        parcial->hilo_creado = pthread_create(&parcial->hilo, NULL, cargar_padron_parcial, parcial) == 0;
+        if(!parcial->hilo_creado) cargar_padron_parcial(parcial);
+    }
+
+    bool cargados = true;
+    size_t total = 0;
+    for(size_t i=0;i<archivos;i++)
+    {
+        if(parciales[i].hilo_creado) pthread_join(parciales[i].hilo, NULL);
+        if(!parciales[i].claves) cargados = false;
+        total += parciales[i].cantidad;
+    }
+    salida_establecer(parciales[0].salida);
+
+    uint64_t* claves = cargados ? malloc((total ? total : 1) * sizeof(uint64_t)) : NULL;
+    if(cargados && !claves) error_manager(OTRO);
+
+    if(claves)
+    {
+        for(size_t i=0;i<archivos;i++)
+            if(parciales[i].repetidas)
+                fprintf(stderr, "Padron: %s tiene %zu filas repetidas\n", parciales[i].nombre, parciales[i].repetidas);
+
+        *cantidad = unir_padrones(parciales, archivos, claves);
+        if(*cantidad == SIZE_MAX) { free(claves); claves = NULL; error_manager(OTRO); }
+    }
+
+    for(size_t i=0;i<archivos;i++)
+        free(parciales[i].claves);
+    free(parciales);
+    free(copia);
+    return claves;
 }
 
 /*
- Abre el archivo de listas y crea un partido_t por cada lista de candidatos (cada linea del archivo es una lista).
- Carga cada partido_t creado dentro de la lista de maquina->listas
- Post: Devuelve false en caso de no haber modificado maquina->listas.
+ Crea un partido_t con la fila del archivo de listas (cada linea del archivo es una lista),
+ con un postulante por cargo, y lo agrega al final de los partidos de la carga.
+ Post: Devuelve false en caso de no haber agregado el partido.
 */
-bool enlistar_partido(fila_csv_t* fila, lista_t* lista, size_t columnas) {
+bool enlistar_partido(const campo_csv_t* campos, size_t cantidad, void* extra) {
+    carga_listas_t* carga = extra;
+    size_t largo = carga->cargos->cantidad;
+
+    // Una lista necesita numero, nombre y un postulante por cargo; lo que
+    // sobre se ignora.
+    if(cantidad < 2 + largo) return error_manager(LECTURA);
 
-    size_t partido_id = (size_t)strtol(obtener_columna(fila, 0), NULL, 10);
-    free(obtener_columna(fila, 0));
+    size_t partido_id = (size_t)strtol(campos[0].dato, NULL, 10);
 
-    char** postulantes = malloc(sizeof(char*)*(columnas-2));
-    //char* postulantes[columnas-2];
-    size_t** votos = malloc(sizeof(size_t*)*(columnas-2));
-    //size_t* votos[columnas-2];
+    // Los campos no sobreviven al llamado: el partido se queda con copias.
+    char* nombre = copiar_clave(campos[1].dato);
+    char** postulantes = malloc(sizeof(char*)*largo);
+    size_t copiados = 0;
 
-    for(size_t i=0;i<columnas-2;i++)
+    if(nombre && postulantes)
     {
-        size_t* cero = malloc(sizeof(size_t*));
-        *cero = 0;
-        votos[i] = cero;
-        postulantes[i] = obtener_columna(fila, i+2);
-        #ifdef DEBUG
-        printf("Postulante: %s, votos: %zu\n", postulantes[i], *votos[i]);
-        #endif
+        for(;copiados<largo;copiados++)
+        {
+            postulantes[copiados] = copiar_clave(campos[copiados+2].dato);
+            if(!postulantes[copiados]) break;
+            #ifdef DEBUG
+            printf("Postulante: %s\n", postulantes[copiados]);
+            #endif
+        }
     }
 
-    partido_politico_t* partido = partido_crear(partido_id, obtener_columna(fila, 1), postulantes, votos, columnas-2);
-    if(!partido) return NULL; // TODO: O falso?
+    partido_politico_t* partido = NULL;
+    if(copiados == largo && nombre && postulantes)
+        partido = partido_crear(partido_id, nombre, postulantes, largo);
+    if(!partido)
+    {
+        for(size_t i=0;i<copiados;i++) free(postulantes[i]);
+        free(nombre);
+        free(postulantes);
+        return error_manager(OTRO);
+    }
 
-    bool insertar = lista_insertar_ultimo(lista, partido);
-    if(!insertar)
+    if(carga->cantidad == carga->capacidad)
     {
-        free(partido);
-        lista_destruir(lista, destruir_partido);
-        return error_manager(OTRO); // TODO O simplemente False?
+        size_t capacidad = carga->capacidad ? carga->capacidad * 2 : 16;
+        void** partidos = realloc(carga->partidos, capacidad * sizeof(void*));
+        if(!partidos)
+        {
+            destruir_partido(partido);
+            return error_manager(OTRO);
+        }
+        carga->partidos = partidos;
+        carga->capacidad = capacidad;
     }
+    carga->partidos[carga->cantidad++] = partido;
 
     return true;
 }
 
 /*
- Abre el archivo de padron y crea un votante_t por cada votante (cada linea del archivo es un votante).
- Carga cada votante_t creado dentro del hash de maquina->padron
- Post: Devuelve false en caso de no haber modificado maquina->padron.
+ Agrega la clave de documento (tipo, numero) del votante de la fila al arreglo de claves.
+ Post: Devuelve false en caso de error.
 */
-bool enlistar_votante(fila_csv_t* fila, lista_t* lista, size_t columnas) {
+bool enlistar_documento(const campo_csv_t* campos, size_t cantidad, void* extra) {
+    arreglo_claves_t* claves = extra;
 
-    votante_t* votante = votante_crear(obtener_columna(fila, 0), obtener_columna(fila, 1));
-    if(!votante) return error_manager(OTRO); // TODO O simplemente False?
+    uint64_t numero, clave;
 
-    #ifdef DEBUG
-    printf("Padron: %s, %s\n", votante->documento_tipo, votante->documento_numero);
-    #endif
+    // Una fila con documento invalido nunca podria coincidir con un ingreso: se saltea.
+    if(cantidad < 2 || !documento_numero_parsear(campos[1].dato, &numero)) return true;
+    if(!documento_clave_internar(campos[0].dato, numero, &clave)) return error_manager(OTRO);
 
-    bool insertar = lista_insertar_ultimo(lista, votante);
-    if(!insertar)
+    if(claves->cantidad == claves->capacidad)
     {
-        free(votante);
-        lista_destruir(lista, votante_destruir);
-        return error_manager(OTRO); // TODO O simplemente False?
+        size_t capacidad = claves->capacidad ? claves->capacidad * 2 : 1024;
+        uint64_t* datos = realloc(claves->datos, capacidad * sizeof(uint64_t));
+        if(!datos) return error_manager(OTRO);
+        claves->datos = datos;
+        claves->capacidad = capacidad;
     }
+    claves->datos[claves->cantidad++] = clave;
+
+    #ifdef DEBUG
+    printf("Padron: %llx\n", (unsigned long long) clave);
+    #endif
 
     return true;
 }
+
+/* Mezcla un campo en la firma (FNV-1a de a 64 bits) */
+static uint64_t firma_mezclar(uint64_t firma, uint64_t campo) {
+    return (firma ^ campo) * UINT64_C(0x100000001b3);
+}
+
+/*
+ Identifica una version de un archivo por su inodo, tamanio, y fechas de
+ modificacion y de cambio con nanosegundos, para detectar datos derivados
+ (filtros, indices) que quedaron viejos. La fecha de cambio no se puede
+ volver atras, asi que reescribir el archivo y restaurar su fecha de
+ modificacion tambien cambia la firma. Para una lista de archivos separados
+ por comas combina las firmas de todos.
+ Post: devuelve 0 si no se pudo consultar algun archivo.
+*/
+uint64_t firma_archivo(const char* nombre) {
+    char* copia = copiar_clave(nombre);
+    if(!copia) return 0;
+
+    uint64_t firma = UINT64_C(0xcbf29ce484222325);
+    char* resto;
+    for(char* archivo=strtok_r(copia, PADRONES_SEPARADOR, &resto);archivo && firma;archivo=strtok_r(NULL, PADRONES_SEPARADOR, &resto))
+    {
+        struct stat datos;
+        if(stat(archivo, &datos) != 0) { firma = 0; break; }
+
+        uint64_t campos[] = { (uint64_t) datos.st_dev, (uint64_t) datos.st_ino, (uint64_t) datos.st_size,
+                              (uint64_t) datos.st_mtim.tv_sec, (uint64_t) datos.st_mtim.tv_nsec,
+                              (uint64_t) datos.st_ctim.tv_sec, (uint64_t) datos.st_ctim.tv_nsec };
+        for(size_t i=0;i<sizeof(campos)/sizeof(campos[0]);i++)
+            firma = firma_mezclar(firma, campos[i]);
+        // 0 queda para el error.
+        if(!firma) firma = 1;
+    }
+    free(copia);
+    return firma;
+}
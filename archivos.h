@@ -2,17 +2,23 @@
 #define ARCHIVOS_H
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 
 #include "lista.h"
-#include "parser.h"
+#include "csv.h"
+#include "maquina.h"
+#include "votante_partido.h"
 
-typedef struct maquina_votacion maquina_votacion_t;
-
-lista_t* cargar_csv_en_lista(maquina_votacion_t* maquina, const char* nombre, bool (*func)(fila_csv_t*, lista_t*, size_t) );
-bool enlistar_partido(fila_csv_t* fila, lista_t* lista, size_t columnas);
-bool enlistar_votante(fila_csv_t* fila, lista_t* lista, size_t columnas);
-void destruir_votante(void* dato);
+bool cargar_csv(const char* nombre, visitar_registro_t func, void* extra);
+lista_t* cargar_listas(const char* nombre, cargos_t* cargos);
+void cargos_destruir(cargos_t* cargos);
+uint64_t* cargar_padron(const char* nombre, size_t* cantidad);
+uint64_t* cargar_padrones(const char* nombres, size_t* cantidad);
+bool padrones_legibles(const char* nombres);
+bool enlistar_partido(const campo_csv_t* campos, size_t cantidad, void* carga);
+bool enlistar_documento(const campo_csv_t* campos, size_t cantidad, void* claves);
+uint64_t firma_archivo(const char* nombre);
 void destruir_partido(void* dato);
 
 #endif
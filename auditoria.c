@@ -0,0 +1,471 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "auditoria.h"
+#include "contenedores.h"
+#include "planificador.h"
+#include "sha256.h"
+
+#define CABECERA_BYTES 16
+#define SELLO_BYTES (4 + 2 * SHA256_BYTES)
+#define CIERRE_BYTES (4 + 8 + 8 + 2 * SHA256_BYTES)
+// Segmentos que verifica cada tarea
+#define TRAMO_SEGMENTOS 64
+
+typedef struct resumen {
+    uint8_t bytes[SHA256_BYTES];
+} resumen_t;
+
+PILA_VALORES(resumenes, resumen_t)
+
+struct auditoria {
+    FILE* archivo;
+    size_t cargos;
+    size_t largo_registro;
+    // Boletas del segmento sin sellar, tal como estan en el archivo
+    uint8_t* segmento;
+    size_t en_segmento;
+    uint64_t boletas;
+    uint8_t cadena[SHA256_BYTES];
+    // Resumen de cada segmento sellado, para la raiz
+    resumenes_t resumenes;
+    bool fallo;
+};
+
+static void poner_u32(uint8_t* destino, uint32_t valor) {
+    for(size_t i=0;i<4;i++) destino[i] = (uint8_t) (valor >> (8*i));
+}
+
+static void poner_u64(uint8_t* destino, uint64_t valor) {
+    for(size_t i=0;i<8;i++) destino[i] = (uint8_t) (valor >> (8*i));
+}
+
+static uint32_t leer_u32(const uint8_t* origen) {
+    uint32_t valor = 0;
+    for(size_t i=0;i<4;i++) valor |= (uint32_t) origen[i] << (8*i);
+    return valor;
+}
+
+static uint64_t leer_u64(const uint8_t* origen) {
+    uint64_t valor = 0;
+    for(size_t i=0;i<8;i++) valor |= (uint64_t) origen[i] << (8*i);
+    return valor;
+}
+
+/* Cadena del segmento indice a partir de la del anterior */
+static void encadenar(const uint8_t anterior[SHA256_BYTES], const uint8_t resumen[SHA256_BYTES], uint64_t indice, uint32_t cantidad, uint8_t cadena[SHA256_BYTES]) {
+    uint8_t numeros[12];
+    poner_u64(numeros, indice);
+    poner_u32(numeros + 8, cantidad);
+
+    sha256_t sha;
+    sha256_iniciar(&sha);
+    sha256_agregar(&sha, anterior, SHA256_BYTES);
+    sha256_agregar(&sha, resumen, SHA256_BYTES);
+    sha256_agregar(&sha, numeros, sizeof(numeros));
+    sha256_terminar(&sha, cadena);
+}
+
+/* Raiz del arbol de Merkle sobre los resumenes, que quedan modificados */
+static void calcular_raiz(resumen_t* nodos, size_t cantidad, uint8_t raiz[SHA256_BYTES]) {
+    if(!cantidad) { memset(raiz, 0, SHA256_BYTES); return; }
+
+    while(cantidad > 1)
+    {
+        size_t padres = 0;
+        for(size_t i=0;i<cantidad;i+=2)
+        {
+            if(i+1 == cantidad) { nodos[padres++] = nodos[i]; continue; }
+
+            uint8_t prefijo = 0x01;
+            sha256_t sha;
+            sha256_iniciar(&sha);
+            sha256_agregar(&sha, &prefijo, 1);
+            sha256_agregar(&sha, nodos[i].bytes, SHA256_BYTES);
+            sha256_agregar(&sha, nodos[i+1].bytes, SHA256_BYTES);
+            sha256_terminar(&sha, nodos[padres++].bytes);
+        }
+        cantidad = padres;
+    }
+    memcpy(raiz, nodos[0].bytes, SHA256_BYTES);
+}
+
+static void escribir_cabecera(uint8_t cabecera[CABECERA_BYTES], size_t cargos) {
+    memcpy(cabecera, AUDITORIA_MAGIA, 4);
+    poner_u32(cabecera + 4, AUDITORIA_VERSION);
+    poner_u32(cabecera + 8, (uint32_t) cargos);
+    poner_u32(cabecera + 12, AUDITORIA_BOLETAS_POR_SEGMENTO);
+}
+
+
+/* ******************************************************************
+ *                          ESCRITURA
+ * *****************************************************************/
+
+auditoria_t* auditoria_crear(const char* nombre, size_t cargos) {
+    auditoria_t* auditoria = malloc(sizeof(auditoria_t));
+    if(!auditoria) return NULL;
+
+    auditoria->cargos = cargos;
+    auditoria->largo_registro = 8 + 4 * cargos;
+    auditoria->segmento = malloc(AUDITORIA_BOLETAS_POR_SEGMENTO * auditoria->largo_registro);
+    auditoria->archivo = NULL;
+
+    int fd = auditoria->segmento ? open(nombre, O_WRONLY | O_CREAT | O_EXCL, 0644) : -1;
+    if(fd >= 0 && !(auditoria->archivo = fdopen(fd, "wb"))) close(fd);
+
+    uint8_t cabecera[CABECERA_BYTES];
+    escribir_cabecera(cabecera, cargos);
+    if(!auditoria->archivo || fwrite(cabecera, 1, CABECERA_BYTES, auditoria->archivo) != CABECERA_BYTES || fflush(auditoria->archivo) != 0)
+    {
+        if(auditoria->archivo) { fclose(auditoria->archivo); unlink(nombre); }
+        free(auditoria->segmento);
+        free(auditoria);
+        return NULL;
+    }
+
+    sha256(cabecera, CABECERA_BYTES, auditoria->cadena);
+    auditoria->en_segmento = 0;
+    auditoria->boletas = 0;
+    resumenes_iniciar(&auditoria->resumenes);
+    auditoria->fallo = false;
+    return auditoria;
+}
+
+/* Sella el segmento abierto: resumen, cadena y sello en el archivo */
+static void sellar(auditoria_t* auditoria) {
+    if(!auditoria->en_segmento) return;
+
+    resumen_t resumen;
+    sha256(auditoria->segmento, auditoria->en_segmento * auditoria->largo_registro, resumen.bytes);
+    encadenar(auditoria->cadena, resumen.bytes, auditoria->resumenes.cantidad, (uint32_t) auditoria->en_segmento, auditoria->cadena);
+
+    uint8_t sello[SELLO_BYTES];
+    poner_u32(sello, (uint32_t) auditoria->en_segmento);
+    memcpy(sello + 4, resumen.bytes, SHA256_BYTES);
+    memcpy(sello + 4 + SHA256_BYTES, auditoria->cadena, SHA256_BYTES);
+
+    if(fwrite(sello, 1, SELLO_BYTES, auditoria->archivo) != SELLO_BYTES || fflush(auditoria->archivo) != 0
+        || !resumenes_apilar(&auditoria->resumenes, resumen))
+        auditoria->fallo = true;
+    auditoria->en_segmento = 0;
+}
+
+void auditoria_registrar(auditoria_t* auditoria, const uint32_t* partidos) {
+    uint8_t* registro = auditoria->segmento + auditoria->en_segmento * auditoria->largo_registro;
+    poner_u64(registro, ++auditoria->boletas);
+    for(size_t i=0;i<auditoria->cargos;i++)
+        poner_u32(registro + 8 + 4*i, partidos[i]);
+
+    if(fwrite(registro, 1, auditoria->largo_registro, auditoria->archivo) != auditoria->largo_registro)
+        auditoria->fallo = true;
+
+    if(++auditoria->en_segmento == AUDITORIA_BOLETAS_POR_SEGMENTO)
+        sellar(auditoria);
+}
+
+bool auditoria_cerrar(auditoria_t* auditoria) {
+    sellar(auditoria);
+
+    uint8_t cierre[CIERRE_BYTES];
+    memcpy(cierre, AUDITORIA_MAGIA_CIERRE, 4);
+    poner_u64(cierre + 4, auditoria->boletas);
+    poner_u64(cierre + 12, auditoria->resumenes.cantidad);
+    calcular_raiz(auditoria->resumenes.datos, auditoria->resumenes.cantidad, cierre + 20);
+    memcpy(cierre + 20 + SHA256_BYTES, auditoria->cadena, SHA256_BYTES);
+
+    bool escrito = !auditoria->fallo && fwrite(cierre, 1, CIERRE_BYTES, auditoria->archivo) == CIERRE_BYTES;
+    if(fclose(auditoria->archivo) != 0) escrito = false;
+    auditoria->archivo = NULL;
+
+    auditoria_destruir(auditoria);
+    return escrito;
+}
+
+void auditoria_destruir(auditoria_t* auditoria) {
+    if(!auditoria) return;
+    if(auditoria->archivo) fclose(auditoria->archivo);
+    resumenes_liberar(&auditoria->resumenes);
+    free(auditoria->segmento);
+    free(auditoria);
+}
+
+
+/* ******************************************************************
+ *                          VERIFICACION
+ * *****************************************************************/
+
+/* Archivo que se esta verificando, mapeado en memoria */
+typedef struct registro_auditoria {
+    const char* nombre;
+    uint8_t* datos;
+    size_t largo;
+    size_t largo_registro;
+    size_t largo_segmento;
+    uint64_t boletas;
+    uint64_t segmentos;
+    // La estructura es valida y sus segmentos se reparten en tramos
+    bool verificable;
+    // Primer problema: motivo y segmento (SIZE_MAX si no es de un segmento)
+    const char* error;
+    size_t segmento_error;
+} registro_auditoria_t;
+
+/* Segmentos [desde, hasta) de un archivo, que verifica una tarea */
+typedef struct tramo {
+    registro_auditoria_t* registro;
+    size_t desde;
+    size_t hasta;
+    trabajo_t* trabajo;
+} tramo_t;
+
+typedef struct verificacion {
+    // Protege los errores de los registros, que informan varios hilos
+    pthread_mutex_t mutex;
+} verificacion_t;
+
+/* Anota el problema si es el primero del archivo (por segmento) */
+static void anotar_error(registro_auditoria_t* registro, const char* error, size_t segmento) {
+    if(!registro->error || segmento < registro->segmento_error)
+    {
+        registro->error = error;
+        registro->segmento_error = segmento;
+    }
+}
+
+static const uint8_t* sello_de(const registro_auditoria_t* registro, size_t segmento) {
+    return registro->datos + CABECERA_BYTES + segmento * registro->largo_segmento + AUDITORIA_BOLETAS_POR_SEGMENTO * registro->largo_registro;
+}
+
+/* Mapea el archivo y valida su estructura: cabecera, cierre y largo */
+static bool abrir_registro(registro_auditoria_t* registro, const char* nombre) {
+    registro->nombre = nombre;
+    registro->datos = NULL;
+    registro->error = NULL;
+    registro->segmento_error = SIZE_MAX;
+    registro->verificable = false;
+
+    int fd = open(nombre, O_RDONLY);
+    struct stat estado;
+    if(fd < 0 || fstat(fd, &estado) != 0)
+    {
+        if(fd >= 0) close(fd);
+        registro->error = "no se pudo abrir";
+        return false;
+    }
+
+    registro->largo = (size_t) estado.st_size;
+    if(registro->largo < CABECERA_BYTES + CIERRE_BYTES)
+    {
+        close(fd);
+        registro->error = registro->largo < CABECERA_BYTES ? "no es un registro de auditoria" : "sin cierre";
+        return false;
+    }
+
+    void* mapa = mmap(NULL, registro->largo, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(mapa == MAP_FAILED)
+    {
+        registro->error = "no se pudo leer";
+        return false;
+    }
+    registro->datos = mapa;
+
+    const uint8_t* datos = registro->datos;
+    uint32_t cargos = leer_u32(datos + 8);
+    if(memcmp(datos, AUDITORIA_MAGIA, 4) != 0 || leer_u32(datos + 4) != AUDITORIA_VERSION
+        || leer_u32(datos + 12) != AUDITORIA_BOLETAS_POR_SEGMENTO || !cargos || cargos > 1024)
+    {
+        registro->error = "no es un registro de auditoria";
+        return false;
+    }
+    registro->largo_registro = 8 + 4 * (size_t) cargos;
+    registro->largo_segmento = AUDITORIA_BOLETAS_POR_SEGMENTO * registro->largo_registro + SELLO_BYTES;
+
+    const uint8_t* cierre = datos + registro->largo - CIERRE_BYTES;
+    if(memcmp(cierre, AUDITORIA_MAGIA_CIERRE, 4) != 0)
+    {
+        registro->error = "sin cierre";
+        return false;
+    }
+    registro->boletas = leer_u64(cierre + 4);
+    registro->segmentos = leer_u64(cierre + 12);
+
+    // Todos los segmentos llenos salvo el ultimo: el largo queda determinado.
+    uint64_t segmentos = (registro->boletas + AUDITORIA_BOLETAS_POR_SEGMENTO - 1) / AUDITORIA_BOLETAS_POR_SEGMENTO;
+    uint64_t largo = CABECERA_BYTES + registro->boletas * registro->largo_registro + segmentos * SELLO_BYTES + CIERRE_BYTES;
+    if(registro->segmentos != segmentos || registro->boletas > registro->largo || largo != registro->largo)
+    {
+        registro->error = "largo inconsistente con el cierre";
+        return false;
+    }
+    registro->verificable = true;
+    return true;
+}
+
+/* Verifica los segmentos del tramo: resumen de sus boletas y cadena */
+static void verificar_tramo(void* dato, void* extra) {
+    tramo_t* tramo = dato;
+    verificacion_t* verificacion = extra;
+    registro_auditoria_t* registro = tramo->registro;
+
+    for(size_t segmento=tramo->desde;segmento<tramo->hasta;segmento++)
+    {
+        uint64_t esperadas = registro->boletas - (uint64_t) segmento * AUDITORIA_BOLETAS_POR_SEGMENTO;
+        if(esperadas > AUDITORIA_BOLETAS_POR_SEGMENTO) esperadas = AUDITORIA_BOLETAS_POR_SEGMENTO;
+
+        const uint8_t* boletas = registro->datos + CABECERA_BYTES + segmento * registro->largo_segmento;
+        const uint8_t* sello = boletas + esperadas * registro->largo_registro;
+
+        uint8_t anterior[SHA256_BYTES], resumen[SHA256_BYTES], cadena[SHA256_BYTES];
+        if(segmento == 0)
+            sha256(registro->datos, CABECERA_BYTES, anterior);
+        else
+            memcpy(anterior, sello_de(registro, segmento-1) + 4 + SHA256_BYTES, SHA256_BYTES);
+
+        const char* error = NULL;
+        if(leer_u32(sello) != esperadas)
+            error = "cantidad de boletas del sello";
+        else
+        {
+            sha256(boletas, esperadas * registro->largo_registro, resumen);
+            encadenar(anterior, resumen, segmento, (uint32_t) esperadas, cadena);
+            if(memcmp(resumen, sello + 4, SHA256_BYTES) != 0)
+                error = "resumen de las boletas distinto al del sello";
+            else if(memcmp(cadena, sello + 4 + SHA256_BYTES, SHA256_BYTES) != 0)
+                error = "cadena rota";
+        }
+
+        if(error)
+        {
+            pthread_mutex_lock(&verificacion->mutex);
+            anotar_error(registro, error, segmento);
+            pthread_mutex_unlock(&verificacion->mutex);
+            return;
+        }
+    }
+}
+
+/* Con los segmentos verificados, compara el cierre con la ultima cadena y la raiz */
+static void verificar_cierre(registro_auditoria_t* registro) {
+    const uint8_t* cierre = registro->datos + registro->largo - CIERRE_BYTES;
+
+    uint8_t cadena[SHA256_BYTES];
+    if(registro->segmentos)
+    {
+        const uint8_t* sello = cierre - SELLO_BYTES;
+        memcpy(cadena, sello + 4 + SHA256_BYTES, SHA256_BYTES);
+    }
+    else
+        sha256(registro->datos, CABECERA_BYTES, cadena);
+
+    if(memcmp(cadena, cierre + 20 + SHA256_BYTES, SHA256_BYTES) != 0)
+    {
+        registro->error = "cadena del cierre";
+        return;
+    }
+
+    resumen_t* resumenes = malloc((registro->segmentos ? registro->segmentos : 1) * sizeof(resumen_t));
+    if(!resumenes) { registro->error = "sin memoria"; return; }
+
+    for(size_t segmento=0;segmento<registro->segmentos;segmento++)
+    {
+        // El ultimo sello esta justo antes del cierre, aunque el segmento no este lleno.
+        const uint8_t* sello = segmento+1 == registro->segmentos ? cierre - SELLO_BYTES : sello_de(registro, segmento);
+        memcpy(resumenes[segmento].bytes, sello + 4, SHA256_BYTES);
+    }
+
+    uint8_t raiz[SHA256_BYTES];
+    calcular_raiz(resumenes, registro->segmentos, raiz);
+    free(resumenes);
+
+    if(memcmp(raiz, cierre + 20, SHA256_BYTES) != 0)
+        registro->error = "raiz del cierre";
+}
+
+static void informar_registro(const registro_auditoria_t* registro) {
+    if(registro->error && registro->segmento_error != SIZE_MAX)
+        printf("%s: ERROR %s en el segmento %zu\n", registro->nombre, registro->error, registro->segmento_error);
+    else if(registro->error)
+        printf("%s: ERROR %s\n", registro->nombre, registro->error);
+    else
+    {
+        const uint8_t* raiz = registro->datos + registro->largo - CIERRE_BYTES + 20;
+        printf("%s: OK %llu boletas, raiz ", registro->nombre, (unsigned long long) registro->boletas);
+        for(size_t i=0;i<SHA256_BYTES;i++) printf("%02x", raiz[i]);
+        printf("\n");
+    }
+}
+
+bool auditoria_verificar(char* const* nombres, size_t cantidad, size_t hilos) {
+    registro_auditoria_t* registros = malloc((cantidad ? cantidad : 1) * sizeof(registro_auditoria_t));
+    if(!registros) return false;
+
+    // Estructura de cada archivo, y los tramos en que se reparten sus segmentos
+    size_t cantidad_tramos = 0;
+    for(size_t i=0;i<cantidad;i++)
+        if(abrir_registro(&registros[i], nombres[i]))
+            cantidad_tramos += (registros[i].segmentos + TRAMO_SEGMENTOS - 1) / TRAMO_SEGMENTOS;
+
+    verificacion_t verificacion;
+    pthread_mutex_init(&verificacion.mutex, NULL);
+
+    tramo_t* tramos = malloc((cantidad_tramos ? cantidad_tramos : 1) * sizeof(tramo_t));
+    planificador_t* planificador = tramos ? planificador_crear(hilos, verificar_tramo, &verificacion) : NULL;
+
+    size_t programados = 0;
+    for(size_t i=0;i<cantidad && planificador;i++)
+    {
+        registro_auditoria_t* registro = &registros[i];
+        // Los hilos ya pueden estar anotando errores: se mira verificable.
+        for(size_t desde=0;registro->verificable && desde<registro->segmentos;desde+=TRAMO_SEGMENTOS)
+        {
+            tramo_t* tramo = &tramos[programados];
+            tramo->registro = registro;
+            tramo->desde = desde;
+            tramo->hasta = desde + TRAMO_SEGMENTOS < registro->segmentos ? desde + TRAMO_SEGMENTOS : registro->segmentos;
+            tramo->trabajo = trabajo_crear(planificador);
+
+            if(tramo->trabajo && planificador_encolar(planificador, tramo->trabajo, tramo))
+                programados++;
+            else
+            {
+                trabajo_destruir(tramo->trabajo);
+                pthread_mutex_lock(&verificacion.mutex);
+                anotar_error(registro, "sin memoria", SIZE_MAX);
+                pthread_mutex_unlock(&verificacion.mutex);
+            }
+        }
+    }
+
+    // Espera a que terminen todos los tramos.
+    planificador_destruir(planificador);
+    for(size_t i=0;i<programados;i++)
+        trabajo_destruir(tramos[i].trabajo);
+    free(tramos);
+    pthread_mutex_destroy(&verificacion.mutex);
+
+    bool validos = planificador != NULL;
+    for(size_t i=0;i<cantidad;i++)
+    {
+        registro_auditoria_t* registro = &registros[i];
+        if(!planificador && !registro->error) registro->error = "sin memoria";
+        if(!registro->error) verificar_cierre(registro);
+
+        informar_registro(registro);
+        if(registro->error) validos = false;
+        if(registro->datos) munmap(registro->datos, registro->largo);
+    }
+    free(registros);
+    return validos;
+}
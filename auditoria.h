@@ -0,0 +1,80 @@
+#ifndef AUDITORIA_H
+#define AUDITORIA_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/* ******************************************************************
+ *                DEFINICION DE LOS TIPOS DE DATOS
+ * *****************************************************************/
+
+/* Registro de auditoria de una mesa: cada boleta contada (votar fin) se
+ * agrega al final del archivo, y cada AUDITORIA_BOLETAS_POR_SEGMENTO boletas
+ * se sella el segmento con su resumen SHA-256 encadenado al sello anterior.
+ * Contar una boleta solo la copia al buffer del archivo; el resumen se
+ * calcula de a un segmento. Al cerrar la mesa se sella lo que quede y se
+ * escribe el cierre, con la raiz de un arbol de Merkle sobre los resumenes
+ * de los segmentos.
+ *
+ * Formato, con los enteros en little endian:
+ *     cabecera: "AUD1", version, cargos, boletas por segmento (u32 cada uno)
+ *     por cada boleta: numero (u64, desde 1) y el id del partido votado para
+ *         cada cargo (u32 cada uno)
+ *     despues de las boletas de cada segmento, su sello: cantidad de boletas
+ *         (u32), resumen de sus boletas y cadena (32 bytes cada uno)
+ *     cierre: "FIN1", boletas y segmentos (u64 cada uno), raiz y cadena
+ *
+ * La cadena de la cabecera es su resumen; la de cada segmento es el resumen
+ * de la cadena anterior, el resumen del segmento, su indice (u64) y su
+ * cantidad (u32). Cada nodo del arbol de Merkle es el resumen del byte 0x01
+ * y sus dos hijos; un nodo sin par sube tal cual. Sin segmentos, la raiz es
+ * cero.
+ *
+ * Como cada sello guarda la cadena anterior, los segmentos se verifican
+ * independientes entre si: la verificacion reparte los segmentos de todos
+ * los archivos entre varios hilos. */
+
+#define AUDITORIA_MAGIA "AUD1"
+#define AUDITORIA_MAGIA_CIERRE "FIN1"
+#define AUDITORIA_VERSION 1
+#define AUDITORIA_BOLETAS_POR_SEGMENTO 256
+
+typedef struct auditoria auditoria_t;
+
+
+/* ******************************************************************
+ *                    PRIMITIVAS DEL ESCRITOR
+ * *****************************************************************/
+
+// Crea el registro de auditoria nombre para boletas de la cantidad de cargos.
+// No reemplaza un archivo existente: un registro no se pisa.
+// Post: devuelve NULL si ya existe o en caso de error.
+auditoria_t* auditoria_crear(const char* nombre, size_t cargos);
+
+// Agrega una boleta con el id del partido votado para cada cargo (0 si no
+// hay). Si la escritura falla, el error queda para auditoria_cerrar.
+// Pre: fue creado y no cerrado.
+void auditoria_registrar(auditoria_t* auditoria, const uint32_t* partidos);
+
+// Sella lo pendiente, escribe el cierre y destruye el registro.
+// Post: devuelve false si alguna escritura fallo.
+bool auditoria_cerrar(auditoria_t* auditoria);
+
+// Destruye el registro sin cerrarlo; las boletas del ultimo segmento quedan
+// sin sellar y el archivo no pasa la verificacion.
+void auditoria_destruir(auditoria_t* auditoria);
+
+
+/* ******************************************************************
+ *                    VERIFICACION
+ * *****************************************************************/
+
+// Verifica los registros de auditoria, repartiendo sus segmentos entre la
+// cantidad de hilos indicada, e informa en stdout una linea por archivo con
+// su raiz o con el primer problema encontrado.
+// Pre: hilos > 0.
+// Post: devuelve true si todos son validos y estan cerrados.
+bool auditoria_verificar(char* const* nombres, size_t cantidad, size_t hilos);
+
+#endif // AUDITORIA_H
@@ -0,0 +1,419 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "lista.h"
+#include "cola.h"
+#include "pila.h"
+
+/*
+ Microbenchmarks de los TDAs lista, cola y pila.
+
+ Cada caso corre un patron de acceso sobre n elementos, para varios n, y
+ muestra el tiempo y las llamadas a malloc, realloc y free por operacion. Las
+ llamadas se cuentan envolviendo las funciones de la libc al enlazar (ver el
+ objetivo bench del Makefile), asi que cuentan tambien las de los TDAs.
+
+ Uso: bench_tdas [estructura...]   (lista, cola o pila; por defecto todas)
+*/
+
+// Operaciones aproximadas por medicion: los n chicos se repiten en rondas
+#define OPERACIONES_OBJETIVO (4 * 1024 * 1024)
+
+static const size_t TAMANIOS[] = { 16, 256, 4096, 65536, 1048576 };
+#define CANTIDAD_TAMANIOS (sizeof(TAMANIOS) / sizeof(TAMANIOS[0]))
+
+
+/* ******************************************************************
+ *                  CONTEO DE RESERVAS DE MEMORIA
+ * *****************************************************************/
+
+static size_t cuenta_malloc = 0;
+static size_t cuenta_realloc = 0;
+static size_t cuenta_free = 0;
+
+void* __real_malloc(size_t tamanio);
+void* __real_calloc(size_t cantidad, size_t tamanio);
+void* __real_realloc(void* puntero, size_t tamanio);
+void __real_free(void* puntero);
+
+void* __wrap_malloc(size_t tamanio) {
+    cuenta_malloc++;
+    return __real_malloc(tamanio);
+}
+
+void* __wrap_calloc(size_t cantidad, size_t tamanio) {
+    cuenta_malloc++;
+    return __real_calloc(cantidad, tamanio);
+}
+
+void* __wrap_realloc(void* puntero, size_t tamanio) {
+    cuenta_realloc++;
+    return __real_realloc(puntero, tamanio);
+}
+
+void __wrap_free(void* puntero) {
+    if(puntero) cuenta_free++;
+    __real_free(puntero);
+}
+
+
+/* ******************************************************************
+ *                          MEDICIONES
+ * *****************************************************************/
+
+typedef struct medicion {
+    struct timespec inicio;
+    size_t malloc_inicio;
+    size_t realloc_inicio;
+    size_t free_inicio;
+    // Resultado
+    double segundos;
+    size_t operaciones;
+    size_t mallocs;
+    size_t reallocs;
+    size_t frees;
+} medicion_t;
+
+/* Los casos guardan aca lo que leen, para que el compilador no descarte los ciclos */
+static volatile uintptr_t sumidero;
+
+/* Valores que se guardan en los TDAs. pila_apilar no acepta NULL. */
+static char valores[1];
+#define VALOR ((void*) valores)
+
+static double segundos_desde(const struct timespec* inicio) {
+    struct timespec fin;
+    clock_gettime(CLOCK_MONOTONIC, &fin);
+    return (double) (fin.tv_sec - inicio->tv_sec) + (double) (fin.tv_nsec - inicio->tv_nsec) / 1e9;
+}
+
+/* Empieza a medir; lo anterior de cada caso es preparacion y no cuenta */
+static void medicion_empezar(medicion_t* medicion) {
+    medicion->malloc_inicio = cuenta_malloc;
+    medicion->realloc_inicio = cuenta_realloc;
+    medicion->free_inicio = cuenta_free;
+    clock_gettime(CLOCK_MONOTONIC, &medicion->inicio);
+}
+
+static void medicion_terminar(medicion_t* medicion, size_t operaciones) {
+    medicion->segundos = segundos_desde(&medicion->inicio);
+    medicion->operaciones = operaciones;
+    medicion->mallocs = cuenta_malloc - medicion->malloc_inicio;
+    medicion->reallocs = cuenta_realloc - medicion->realloc_inicio;
+    medicion->frees = cuenta_free - medicion->free_inicio;
+}
+
+
+/* ******************************************************************
+ *                          CASOS DE LA PILA
+ * *****************************************************************/
+
+/* Apila n y desapila n, desde la pila vacia */
+static void pila_llenar_vaciar(medicion_t* medicion, size_t n, size_t rondas) {
+    pila_t* pila = pila_crear();
+    if(!pila) return;
+
+    medicion_empezar(medicion);
+    for(size_t r=0;r<rondas;r++)
+    {
+        for(size_t i=0;i<n;i++) pila_apilar(pila, VALOR);
+        for(size_t i=0;i<n;i++) sumidero += (uintptr_t) pila_desapilar(pila);
+    }
+    medicion_terminar(medicion, 2 * n * rondas);
+    pila_destruir(pila, NULL);
+}
+
+/* Con n elementos, apila uno y lo desapila */
+static void pila_alternado(medicion_t* medicion, size_t n, size_t rondas) {
+    pila_t* pila = pila_crear();
+    if(!pila) return;
+    for(size_t i=0;i<n;i++) pila_apilar(pila, VALOR);
+
+    medicion_empezar(medicion);
+    for(size_t i=0;i<n*rondas;i++)
+    {
+        pila_apilar(pila, VALOR);
+        sumidero += (uintptr_t) pila_desapilar(pila);
+    }
+    medicion_terminar(medicion, 2 * n * rondas);
+    pila_destruir(pila, NULL);
+}
+
+/* Con n elementos, desapila la mitad y la vuelve a apilar: cruza el umbral de achicar */
+static void pila_serrucho(medicion_t* medicion, size_t n, size_t rondas) {
+    pila_t* pila = pila_crear();
+    if(!pila) return;
+    for(size_t i=0;i<n;i++) pila_apilar(pila, VALOR);
+
+    medicion_empezar(medicion);
+    for(size_t r=0;r<rondas;r++)
+    {
+        for(size_t i=0;i<n/2;i++) sumidero += (uintptr_t) pila_desapilar(pila);
+        for(size_t i=0;i<n/2;i++) pila_apilar(pila, VALOR);
+    }
+    medicion_terminar(medicion, 2 * (n/2) * rondas);
+    pila_destruir(pila, NULL);
+}
+
+
+/* ******************************************************************
+ *                          CASOS DE LA COLA
+ * *****************************************************************/
+
+/* Encola n y desencola n, desde la cola vacia */
+static void cola_llenar_vaciar(medicion_t* medicion, size_t n, size_t rondas) {
+    cola_t* cola = cola_crear();
+    if(!cola) return;
+
+    medicion_empezar(medicion);
+    for(size_t r=0;r<rondas;r++)
+    {
+        for(size_t i=0;i<n;i++) cola_encolar(cola, VALOR);
+        for(size_t i=0;i<n;i++) sumidero += (uintptr_t) cola_desencolar(cola);
+    }
+    medicion_terminar(medicion, 2 * n * rondas);
+    cola_destruir(cola, NULL);
+}
+
+/* Con n elementos, encola uno y desencola otro */
+static void cola_alternado(medicion_t* medicion, size_t n, size_t rondas) {
+    cola_t* cola = cola_crear();
+    if(!cola) return;
+    for(size_t i=0;i<n;i++) cola_encolar(cola, VALOR);
+
+    medicion_empezar(medicion);
+    for(size_t i=0;i<n*rondas;i++)
+    {
+        cola_encolar(cola, VALOR);
+        sumidero += (uintptr_t) cola_desencolar(cola);
+    }
+    medicion_terminar(medicion, 2 * n * rondas);
+    cola_destruir(cola, NULL);
+}
+
+/* Crea una cola, encola n y la destruye llena: incluye crear y destruir */
+static void cola_crear_destruir(medicion_t* medicion, size_t n, size_t rondas) {
+    medicion_empezar(medicion);
+    for(size_t r=0;r<rondas;r++)
+    {
+        cola_t* cola = cola_crear();
+        if(!cola) return;
+        for(size_t i=0;i<n;i++) cola_encolar(cola, VALOR);
+        cola_destruir(cola, NULL);
+    }
+    medicion_terminar(medicion, n * rondas);
+}
+
+
+/* ******************************************************************
+ *                          CASOS DE LA LISTA
+ * *****************************************************************/
+
+/* Lista con n elementos, o NULL en caso de error */
+static lista_t* lista_llena(size_t n) {
+    lista_t* lista = lista_crear();
+    if(!lista) return NULL;
+    for(size_t i=0;i<n;i++)
+        if(!lista_insertar_ultimo(lista, VALOR)) { lista_destruir(lista, NULL); return NULL; }
+    return lista;
+}
+
+/* Crea una lista, inserta n al final y la destruye */
+static void lista_insertar_ultimo_caso(medicion_t* medicion, size_t n, size_t rondas) {
+    medicion_empezar(medicion);
+    for(size_t r=0;r<rondas;r++)
+    {
+        lista_t* lista = lista_llena(n);
+        if(!lista) return;
+        lista_destruir(lista, NULL);
+    }
+    medicion_terminar(medicion, n * rondas);
+}
+
+/* Inserta n al principio y los borra del principio */
+static void lista_primero(medicion_t* medicion, size_t n, size_t rondas) {
+    lista_t* lista = lista_crear();
+    if(!lista) return;
+
+    medicion_empezar(medicion);
+    for(size_t r=0;r<rondas;r++)
+    {
+        for(size_t i=0;i<n;i++) lista_insertar_primero(lista, VALOR);
+        for(size_t i=0;i<n;i++) sumidero += (uintptr_t) lista_borrar_primero(lista);
+    }
+    medicion_terminar(medicion, 2 * n * rondas);
+    lista_destruir(lista, NULL);
+}
+
+/* Con n elementos y el iterador en el medio, inserta uno y lo borra */
+static void lista_iter_medio(medicion_t* medicion, size_t n, size_t rondas) {
+    lista_t* lista = lista_llena(n);
+    if(!lista) return;
+
+    lista_iter_t iter;
+    lista_iter_iniciar(&iter, lista);
+    for(size_t i=0;i<n/2;i++) lista_iter_avanzar(&iter);
+
+    medicion_empezar(medicion);
+    for(size_t i=0;i<n*rondas;i++)
+    {
+        lista_insertar(lista, &iter, VALOR);
+        sumidero += (uintptr_t) lista_borrar(lista, &iter);
+    }
+    medicion_terminar(medicion, 2 * n * rondas);
+    lista_destruir(lista, NULL);
+}
+
+/* Con n elementos, recorre insertando uno antes de cada elemento, y recorre
+ de nuevo borrando los insertados */
+static void lista_iter_intercalado(medicion_t* medicion, size_t n, size_t rondas) {
+    lista_t* lista = lista_llena(n);
+    if(!lista) return;
+
+    medicion_empezar(medicion);
+    for(size_t r=0;r<rondas;r++)
+    {
+        lista_iter_t iter;
+        lista_iter_iniciar(&iter, lista);
+        while(!lista_iter_al_final(&iter))
+        {
+            lista_insertar(lista, &iter, VALOR);
+            lista_iter_avanzar(&iter);
+            lista_iter_avanzar(&iter);
+        }
+
+        lista_iter_iniciar(&iter, lista);
+        while(!lista_iter_al_final(&iter))
+        {
+            sumidero += (uintptr_t) lista_borrar(lista, &iter);
+            lista_iter_avanzar(&iter);
+        }
+    }
+    medicion_terminar(medicion, 2 * n * rondas);
+    lista_destruir(lista, NULL);
+}
+
+/* Recorre los n elementos con un iterador externo */
+static void lista_iterar_externo(medicion_t* medicion, size_t n, size_t rondas) {
+    lista_t* lista = lista_llena(n);
+    if(!lista) return;
+
+    medicion_empezar(medicion);
+    for(size_t r=0;r<rondas;r++)
+    {
+        lista_iter_t iter;
+        uintptr_t suma = 0;
+        for(lista_iter_iniciar(&iter, lista);!lista_iter_al_final(&iter);lista_iter_avanzar(&iter))
+            suma += (uintptr_t) lista_iter_ver_actual(&iter);
+        sumidero += suma;
+    }
+    medicion_terminar(medicion, n * rondas);
+    lista_destruir(lista, NULL);
+}
+
+static bool sumar(void* dato, void* extra) {
+    *(uintptr_t*) extra += (uintptr_t) dato;
+    return true;
+}
+
+/* Recorre los n elementos con el iterador interno */
+static void lista_iterar_interno(medicion_t* medicion, size_t n, size_t rondas) {
+    lista_t* lista = lista_llena(n);
+    if(!lista) return;
+
+    medicion_empezar(medicion);
+    for(size_t r=0;r<rondas;r++)
+    {
+        uintptr_t suma = 0;
+        lista_iterar(lista, sumar, &suma);
+        sumidero += suma;
+    }
+    medicion_terminar(medicion, n * rondas);
+    lista_destruir(lista, NULL);
+}
+
+/* Copia los n elementos a un arreglo */
+static void lista_exportar_caso(medicion_t* medicion, size_t n, size_t rondas) {
+    lista_t* lista = lista_llena(n);
+    void** destino = malloc(n * sizeof(void*));
+    if(!lista || !destino) { free(destino); lista_destruir(lista, NULL); return; }
+
+    medicion_empezar(medicion);
+    for(size_t r=0;r<rondas;r++)
+        sumidero += lista_exportar(lista, destino, n);
+    medicion_terminar(medicion, n * rondas);
+
+    free(destino);
+    lista_destruir(lista, NULL);
+}
+
+
+/* ******************************************************************
+ *                              MAIN
+ * *****************************************************************/
+
+typedef struct caso {
+    const char* estructura;
+    const char* patron;
+    void (*correr)(medicion_t* medicion, size_t n, size_t rondas);
+} caso_t;
+
+static const caso_t CASOS[] = {
+    { "pila", "llenar_vaciar", pila_llenar_vaciar },
+    { "pila", "alternado", pila_alternado },
+    { "pila", "serrucho", pila_serrucho },
+    { "cola", "llenar_vaciar", cola_llenar_vaciar },
+    { "cola", "alternado", cola_alternado },
+    { "cola", "crear_destruir", cola_crear_destruir },
+    { "lista", "insertar_ultimo", lista_insertar_ultimo_caso },
+    { "lista", "primero", lista_primero },
+    { "lista", "iter_medio", lista_iter_medio },
+    { "lista", "iter_intercalado", lista_iter_intercalado },
+    { "lista", "iterar_externo", lista_iterar_externo },
+    { "lista", "iterar_interno", lista_iterar_interno },
+    { "lista", "exportar", lista_exportar_caso },
+};
+#define CANTIDAD_CASOS (sizeof(CASOS) / sizeof(CASOS[0]))
+
+static bool elegido(const char* estructura, int argc, char* argv[]) {
+    if(argc < 2) return true;
+    for(int i=1;i<argc;i++)
+        if(strcmp(argv[i], estructura) == 0) return true;
+    return false;
+}
+
+int main(int argc, char* argv[]) {
+    printf("%-6s %-17s %8s %10s %10s %10s %10s\n", "tda", "patron", "n", "ns/op", "malloc/op", "realloc/op", "free/op");
+
+    for(size_t c=0;c<CANTIDAD_CASOS;c++)
+    {
+        const caso_t* caso = &CASOS[c];
+        if(!elegido(caso->estructura, argc, argv)) continue;
+
+        for(size_t t=0;t<CANTIDAD_TAMANIOS;t++)
+        {
+            size_t n = TAMANIOS[t];
+            size_t rondas = n < OPERACIONES_OBJETIVO ? OPERACIONES_OBJETIVO / n : 1;
+
+            medicion_t medicion = { .operaciones = 0 };
+            caso->correr(&medicion, n, rondas);
+            if(!medicion.operaciones)
+            {
+                fprintf(stderr, "%s %s %zu: no se pudo medir\n", caso->estructura, caso->patron, n);
+                return 1;
+            }
+
+            double operaciones = (double) medicion.operaciones;
+            printf("%-6s %-17s %8zu %10.2f %10.4f %10.4f %10.4f\n", caso->estructura, caso->patron, n,
+                medicion.segundos * 1e9 / operaciones, medicion.mallocs / operaciones,
+                medicion.reallocs / operaciones, medicion.frees / operaciones);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,164 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "bloom.h"
+#include "util.h"
+
+#define BITS_POR_CLAVE 12
+#define PALABRAS_POR_BLOQUE 8   // 8 * 64 bits = 64 bytes
+#define BITS_POR_BLOQUE (PALABRAS_POR_BLOQUE * 64)
+#define SONDAS 7                // bits prendidos por clave
+#define TAM_LINEA_CACHE 64
+
+static const char MAGIA[8] = {'B','L','O','O','M','P','D','2'};
+
+typedef struct bloque {
+    uint64_t palabras[PALABRAS_POR_BLOQUE];
+} bloque_t;
+
+/* Formato del archivo: cabecera seguida de los bloques tal cual estan en memoria */
+typedef struct cabecera {
+    char magia[8];
+    uint64_t firma;
+    uint64_t cantidad_bloques;
+    uint64_t relleno[5];        // para que los bloques queden alineados a 64
+} cabecera_t;
+
+struct bloom {
+    bloque_t* bloques;
+    size_t cantidad_bloques;
+    // Si fue cargado de un archivo, la region mapeada
+    void* mapa;
+    size_t largo_mapa;
+};
+
+/* Lo que bloom_guardar escribe en el archivo */
+typedef struct filtro_firmado {
+    const bloom_t* bloom;
+    uint64_t firma;
+} filtro_firmado_t;
+
+/* Mezcla los bits del hash (finalizador de splitmix64) */
+static uint64_t mezclar(uint64_t x) {
+    x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27; x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+/* Elige el bloque con la parte alta y deja la baja para las sondas */
+static const bloque_t* bloque_de(const bloom_t* bloom, uint64_t hash, uint64_t* sondas) {
+    uint64_t mezcla = mezclar(hash);
+    *sondas = mezclar(mezcla);
+    return &bloom->bloques[(size_t) (((mezcla >> 32) * bloom->cantidad_bloques) >> 32)];
+}
+
+bloom_t* bloom_crear(size_t cantidad) {
+    bloom_t* bloom = malloc(sizeof(bloom_t));
+    if(!bloom) return NULL;
+
+    bloom->cantidad_bloques = (cantidad * BITS_POR_CLAVE + BITS_POR_BLOQUE - 1) / BITS_POR_BLOQUE;
+    if(bloom->cantidad_bloques == 0) bloom->cantidad_bloques = 1;
+    bloom->mapa = NULL;
+    bloom->largo_mapa = 0;
+
+    void* bloques;
+    if(posix_memalign(&bloques, TAM_LINEA_CACHE, bloom->cantidad_bloques * sizeof(bloque_t)) != 0)
+    {
+        free(bloom);
+        return NULL;
+    }
+    memset(bloques, 0, bloom->cantidad_bloques * sizeof(bloque_t));
+    bloom->bloques = bloques;
+    return bloom;
+}
+
+void bloom_agregar(bloom_t* bloom, uint64_t hash) {
+    uint64_t sondas;
+    bloque_t* bloque = (bloque_t*) bloque_de(bloom, hash, &sondas);
+
+    for(size_t i=0;i<SONDAS;i++, sondas >>= 9)
+        bloque->palabras[(sondas >> 6) & 7] |= (uint64_t) 1 << (sondas & 63);
+}
+
+bool bloom_puede_contener(const bloom_t* bloom, uint64_t hash) {
+    uint64_t sondas;
+    const bloque_t* bloque = bloque_de(bloom, hash, &sondas);
+
+    // Se acumula sin cortar antes: el bloque ya esta en cache y se evitan saltos.
+    uint64_t faltantes = 0;
+    for(size_t i=0;i<SONDAS;i++, sondas >>= 9)
+        faltantes |= ~bloque->palabras[(sondas >> 6) & 7] & ((uint64_t) 1 << (sondas & 63));
+
+    return faltantes == 0;
+}
+
+/* Escribe la cabecera y los bloques de un filtro con firma */
+static bool escribir_filtro(FILE* f, const void* dato) {
+    const filtro_firmado_t* filtro = dato;
+    const bloom_t* bloom = filtro->bloom;
+
+    cabecera_t cabecera;
+    memset(&cabecera, 0, sizeof(cabecera_t));
+    memcpy(cabecera.magia, MAGIA, sizeof(MAGIA));
+    cabecera.firma = filtro->firma;
+    cabecera.cantidad_bloques = bloom->cantidad_bloques;
+
+    return fwrite(&cabecera, sizeof(cabecera_t), 1, f) == 1 &&
+           fwrite(bloom->bloques, sizeof(bloque_t), bloom->cantidad_bloques, f) == bloom->cantidad_bloques;
+}
+
+bool bloom_guardar(const bloom_t* bloom, const char* nombre, uint64_t firma) {
+    // Otros procesos pueden tener mapeado el archivo: no se trunca, se reemplaza.
+    filtro_firmado_t filtro = { bloom, firma };
+    return archivo_reemplazar(nombre, escribir_filtro, &filtro);
+}
+
+bloom_t* bloom_cargar(const char* nombre, uint64_t firma) {
+    int fd = open(nombre, O_RDONLY);
+    if(fd < 0) return NULL;
+
+    struct stat datos;
+    if(fstat(fd, &datos) != 0 || (size_t) datos.st_size < sizeof(cabecera_t)) { close(fd); return NULL; }
+
+    size_t largo = (size_t) datos.st_size;
+    void* mapa = mmap(NULL, largo, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if(mapa == MAP_FAILED) return NULL;
+
+    const cabecera_t* cabecera = mapa;
+    if(memcmp(cabecera->magia, MAGIA, sizeof(MAGIA)) != 0 || cabecera->firma != firma ||
+       cabecera->cantidad_bloques == 0 ||
+       largo != sizeof(cabecera_t) + cabecera->cantidad_bloques * sizeof(bloque_t))
+    {
+        munmap(mapa, largo);
+        return NULL;
+    }
+
+    bloom_t* bloom = malloc(sizeof(bloom_t));
+    if(!bloom) { munmap(mapa, largo); return NULL; }
+
+    bloom->bloques = (bloque_t*) ((char*) mapa + sizeof(cabecera_t));
+    bloom->cantidad_bloques = (size_t) cabecera->cantidad_bloques;
+    bloom->mapa = mapa;
+    bloom->largo_mapa = largo;
+    return bloom;
+}
+
+void bloom_destruir(bloom_t* bloom) {
+    if(!bloom) return;
+    if(bloom->mapa)
+        munmap(bloom->mapa, bloom->largo_mapa);
+    else
+        free(bloom->bloques);
+    free(bloom);
+}
@@ -0,0 +1,35 @@
+#ifndef BLOOM_H
+#define BLOOM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/* Filtro de Bloom por bloques: cada clave cae en un unico bloque de 64 bytes
+ (una linea de cache), y todos sus bits se prenden dentro de ese bloque.
+ Puede dar falsos positivos pero nunca falsos negativos. */
+typedef struct bloom bloom_t;
+
+/* Crea un filtro vacio dimensionado para la cantidad de claves indicada.
+ Post: devuelve NULL en caso de error. */
+bloom_t* bloom_crear(size_t cantidad);
+
+/* Agrega el hash de una clave al filtro */
+void bloom_agregar(bloom_t* bloom, uint64_t hash);
+
+/* Devuelve false si la clave con ese hash seguro no fue agregada */
+bool bloom_puede_contener(const bloom_t* bloom, uint64_t hash);
+
+/* Guarda el filtro en un archivo, junto con una firma del origen de los datos.
+ Reemplaza al anterior sin modificarlo, asi no cambia para quien lo tenga cargado.
+ Post: devuelve false en caso de error. */
+bool bloom_guardar(const bloom_t* bloom, const char* nombre, uint64_t firma);
+
+/* Mapea un filtro guardado con bloom_guardar, compartiendo sus paginas con
+ otros procesos que lo tengan abierto.
+ Post: devuelve NULL si no existe, es invalido o su firma no coincide. */
+bloom_t* bloom_cargar(const char* nombre, uint64_t firma);
+
+void bloom_destruir(bloom_t* bloom);
+
+#endif
@@ -11,6 +11,9 @@ struct cola {
 	nodo_t* primero;
 	nodo_t* ultimo;
 	size_t largo;
+	// De donde salen los nodos: propio de la cola o compartido
+	almacen_nodos_t* almacen;
+	bool almacen_propio;
 };
 
 // Crea una cola.
@@ -18,6 +21,28 @@ struct cola {
 
 cola_t* cola_crear(void)
 {
+    almacen_nodos_t* almacen = almacen_crear(sizeof(nodo_t));
+    if(!almacen)
+        return NULL;
+
+    cola_t* cola = cola_crear_en(almacen);
+    if(!cola)
+    {
+        almacen_destruir(almacen);
+        return NULL;
+    }
+
+    cola->almacen_propio = true;
+    return cola;
+}
+
+// Crea una cola que toma sus nodos del almacen indicado.
+// Post: devuelve una nueva cola vaca, o NULL en caso de error.
+cola_t* cola_crear_en(almacen_nodos_t* almacen)
+{
+    if(!almacen || almacen_tamanio(almacen) < sizeof(nodo_t))
+        return NULL;
+
     cola_t* cola = malloc(sizeof(cola_t));
 
     if(!cola)
@@ -26,6 +51,8 @@ cola_t* cola_crear(void)
     cola->primero = NULL;
     cola->ultimo = NULL;
     cola->largo = 0;
+    cola->almacen = almacen;
+    cola->almacen_propio = false;
 
     return cola;
 }
@@ -44,6 +71,9 @@ void cola_destruir(cola_t *cola, void destruir_dato(void*))
         else
             cola_desencolar(cola);
     }
+
+	if(cola->almacen_propio)
+		almacen_destruir(cola->almacen);
 	free(cola);
 }
 
@@ -60,7 +90,7 @@ bool cola_esta_vacia(const cola_t *cola)
 // de la cola.
 bool cola_encolar(cola_t *cola, void* valor)
 {
-	nodo_t* nodo = malloc(sizeof(nodo_t));
+	nodo_t* nodo = almacen_pedir(cola->almacen);
 
 	if(nodo == NULL)
 		return false;
@@ -113,7 +143,7 @@ void* cola_desencolar(cola_t *cola)
 	if(dato != NULL)
 	{
 		nodo_t* nuevo_primero = cola->primero->siguiente;
-		free(cola->primero);
+		almacen_devolver(cola->almacen, cola->primero);
 		cola->primero = nuevo_primero;
 		cola->largo--;
 		return dato;
@@ -3,6 +3,8 @@
 
 #include <stdbool.h>
 
+#include "nodos.h"
+
 
 /* ******************************************************************
  *                DEFINICION DE LOS TIPOS DE DATOS
@@ -22,6 +24,12 @@ typedef struct cola cola_t;
 // Post: devuelve una nueva cola vacía.
 cola_t* cola_crear(void);
 
+// Crea una cola que toma sus nodos del almacen indicado, que puede compartir
+// con otras colas. El almacen debe tener nodos de al menos dos
+// punteros y se destruye despues que la cola.
+// Post: devuelve una nueva cola vacía, o NULL en caso de error.
+cola_t* cola_crear_en(almacen_nodos_t* almacen);
+
 // Destruye la cola. Si se recibe la función destruir_dato por parámetro,
 // para cada uno de los elementos de la cola llama a destruir_dato.
 // Pre: la cola fue creada. destruir_dato es una función capaz de destruir
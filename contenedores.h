@@ -0,0 +1,157 @@
+#ifndef CONTENEDORES_H
+#define CONTENEDORES_H
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+/* ******************************************************************
+ *                DEFINICION DE LOS TIPOS DE DATOS
+ * *****************************************************************/
+
+/* Contenedores generados por macros para un tipo concreto. A diferencia de
+ * pila.h y cola.h, que guardan void*, no necesitan un objeto en el heap ni un
+ * nodo aparte por elemento, y no pasan por funciones de destruccion
+ * genericas. El contenedor mismo es un struct que se declara por valor (por
+ * ejemplo, como campo de otro struct). */
+
+
+/* ******************************************************************
+ *                      PILA DE VALORES
+ * *****************************************************************/
+
+#define PILA_VALORES_CAPACIDAD_INICIAL 8
+
+// PILA_VALORES(nombre, tipo) define nombre_t, una pila que guarda copias de
+// valores de tipo en un arreglo, y sus primitivas:
+//   void nombre_iniciar(nombre_t*)        deja la pila vacia, sin reservar memoria
+//   void nombre_liberar(nombre_t*)        libera el arreglo y la deja vacia
+//   bool nombre_esta_vacia(const nombre_t*)
+//   size_t nombre_largo(const nombre_t*)
+//   bool nombre_apilar(nombre_t*, tipo)   false en caso de error
+//   tipo* nombre_ver_tope(nombre_t*)      NULL si esta vacia; valido hasta el proximo apilar
+//   bool nombre_desapilar(nombre_t*, tipo* valor)
+//                                         copia el tope en valor (si no es NULL);
+//                                         false si estaba vacia
+#define PILA_VALORES(nombre, tipo) \
+typedef struct nombre { \
+    tipo* datos; \
+    size_t cantidad; \
+    size_t capacidad; \
+} nombre##_t; \
+\
+static inline void nombre##_iniciar(nombre##_t* pila) { \
+    pila->datos = NULL; \
+    pila->cantidad = 0; \
+    pila->capacidad = 0; \
+} \
+\
+static inline void nombre##_liberar(nombre##_t* pila) { \
+    free(pila->datos); \
+    nombre##_iniciar(pila); \
+} \
+\
+static inline bool nombre##_esta_vacia(const nombre##_t* pila) { \
+    return pila->cantidad == 0; \
+} \
+\
+static inline size_t nombre##_largo(const nombre##_t* pila) { \
+    return pila->cantidad; \
+} \
+\
+static inline bool nombre##_apilar(nombre##_t* pila, tipo valor) { \
+    if(pila->cantidad == pila->capacidad) \
+    { \
+        size_t capacidad = pila->capacidad ? pila->capacidad * 2 : PILA_VALORES_CAPACIDAD_INICIAL; \
+        tipo* datos = realloc(pila->datos, capacidad * sizeof(tipo)); \
+        if(!datos) return false; \
+        pila->datos = datos; \
+        pila->capacidad = capacidad; \
+    } \
+    pila->datos[pila->cantidad++] = valor; \
+    return true; \
+} \
+\
+static inline tipo* nombre##_ver_tope(nombre##_t* pila) { \
+    return pila->cantidad ? &pila->datos[pila->cantidad - 1] : NULL; \
+} \
+\
+static inline bool nombre##_desapilar(nombre##_t* pila, tipo* valor) { \
+    if(!pila->cantidad) return false; \
+    pila->cantidad--; \
+    if(valor) *valor = pila->datos[pila->cantidad]; \
+    return true; \
+}
+
+
+/* ******************************************************************
+ *                      COLA INTRUSIVA
+ * *****************************************************************/
+
+// COLA_INTRUSIVA_DECLARAR(nombre, tipo) declara nombre_t, una cola de
+// elementos de tipo enlazados por un campo propio, y sus primitivas. Alcanza
+// con que tipo este declarado (puede ser opaco):
+//   void nombre_iniciar(nombre_t*)        deja la cola vacia
+//   bool nombre_esta_vacia(const nombre_t*)
+//   size_t nombre_largo(const nombre_t*)
+//   void nombre_encolar(nombre_t*, tipo*) no reserva memoria: no falla
+//   tipo* nombre_ver_primero(const nombre_t*)
+//   tipo* nombre_desencolar(nombre_t*)    NULL si esta vacia
+// Un elemento esta en a lo sumo una cola a la vez; la cola no es duenia de sus
+// elementos.
+#define COLA_INTRUSIVA_DECLARAR(nombre, tipo) \
+typedef struct nombre { \
+    tipo* primero; \
+    tipo* ultimo; \
+    size_t largo; \
+} nombre##_t; \
+\
+void nombre##_iniciar(nombre##_t* cola); \
+bool nombre##_esta_vacia(const nombre##_t* cola); \
+size_t nombre##_largo(const nombre##_t* cola); \
+void nombre##_encolar(nombre##_t* cola, tipo* elemento); \
+tipo* nombre##_ver_primero(const nombre##_t* cola); \
+tipo* nombre##_desencolar(nombre##_t* cola);
+
+// COLA_INTRUSIVA_DEFINIR(nombre, tipo, enlace) define las primitivas
+// declaradas por COLA_INTRUSIVA_DECLARAR, donde tipo esta completo y tiene un
+// campo tipo* enlace. Va en un solo .c.
+#define COLA_INTRUSIVA_DEFINIR(nombre, tipo, enlace) \
+void nombre##_iniciar(nombre##_t* cola) { \
+    cola->primero = NULL; \
+    cola->ultimo = NULL; \
+    cola->largo = 0; \
+} \
+\
+bool nombre##_esta_vacia(const nombre##_t* cola) { \
+    return cola->primero == NULL; \
+} \
+\
+size_t nombre##_largo(const nombre##_t* cola) { \
+    return cola->largo; \
+} \
+\
+void nombre##_encolar(nombre##_t* cola, tipo* elemento) { \
+    elemento->enlace = NULL; \
+    if(cola->ultimo) \
+        cola->ultimo->enlace = elemento; \
+    else \
+        cola->primero = elemento; \
+    cola->ultimo = elemento; \
+    cola->largo++; \
+} \
+\
+tipo* nombre##_ver_primero(const nombre##_t* cola) { \
+    return cola->primero; \
+} \
+\
+tipo* nombre##_desencolar(nombre##_t* cola) { \
+    tipo* elemento = cola->primero; \
+    if(!elemento) return NULL; \
+    cola->primero = elemento->enlace; \
+    if(!cola->primero) cola->ultimo = NULL; \
+    elemento->enlace = NULL; \
+    cola->largo--; \
+    return elemento; \
+}
+
+#endif // CONTENEDORES_H
@@ -0,0 +1,79 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "conteo.h"
+
+#define LINEA_CACHE 64
+#define CONTADORES_POR_LINEA (LINEA_CACHE / sizeof(size_t))
+// Fragmento compartido por los hilos que no tienen uno propio
+#define FRAGMENTO_COMPARTIDO CONTEO_FRAGMENTOS
+
+struct conteo {
+    size_t contadores;
+    // Distancia entre fragmentos: contadores redondeado a lineas de cache enteras
+    size_t paso;
+    // CONTEO_FRAGMENTOS + 1 fragmentos seguidos
+    size_t* datos;
+};
+
+// Indice de cada hilo, asignado en su primera suma. No se reutilizan.
+static size_t proximo_hilo = 0;
+static __thread size_t indice_hilo;
+static __thread bool indice_asignado = false;
+
+static size_t fragmento_actual(void) {
+    if(!indice_asignado)
+    {
+        indice_hilo = __atomic_fetch_add(&proximo_hilo, 1, __ATOMIC_RELAXED);
+        indice_asignado = true;
+    }
+    return indice_hilo < CONTEO_FRAGMENTOS ? indice_hilo : FRAGMENTO_COMPARTIDO;
+}
+
+conteo_t* conteo_crear(size_t contadores) {
+    conteo_t* conteo = malloc(sizeof(conteo_t));
+    if(!conteo) return NULL;
+
+    conteo->contadores = contadores;
+    conteo->paso = (contadores + CONTADORES_POR_LINEA - 1) / CONTADORES_POR_LINEA * CONTADORES_POR_LINEA;
+    if(!conteo->paso) conteo->paso = CONTADORES_POR_LINEA;
+
+    size_t bytes = (CONTEO_FRAGMENTOS + 1) * conteo->paso * sizeof(size_t);
+    void* datos;
+    if(posix_memalign(&datos, LINEA_CACHE, bytes) != 0) { free(conteo); return NULL; }
+    memset(datos, 0, bytes);
+    conteo->datos = datos;
+    return conteo;
+}
+
+void conteo_sumar_varios(conteo_t* conteo, const size_t* contadores, size_t cantidad) {
+    size_t fragmento = fragmento_actual();
+    size_t* datos = &conteo->datos[fragmento * conteo->paso];
+
+    if(fragmento == FRAGMENTO_COMPARTIDO)
+    {
+        for(size_t i=0;i<cantidad;i++)
+            __atomic_fetch_add(&datos[contadores[i]], 1, __ATOMIC_RELAXED);
+        return;
+    }
+    // Solo este hilo escribe el fragmento: alcanza con leer y escribir, de
+    // forma atomica pero sin lock, para que un lector concurrente no vea la mitad.
+    for(size_t i=0;i<cantidad;i++)
+        __atomic_store_n(&datos[contadores[i]], __atomic_load_n(&datos[contadores[i]], __ATOMIC_RELAXED) + 1, __ATOMIC_RELAXED);
+}
+
+size_t conteo_total(const conteo_t* conteo, size_t contador) {
+    size_t total = 0;
+    for(size_t i=0;i<=CONTEO_FRAGMENTOS;i++)
+        total += __atomic_load_n(&conteo->datos[i * conteo->paso + contador], __ATOMIC_RELAXED);
+    return total;
+}
+
+void conteo_destruir(conteo_t* conteo) {
+    if(!conteo) return;
+    free(conteo->datos);
+    free(conteo);
+}
@@ -0,0 +1,41 @@
+#ifndef CONTEO_H
+#define CONTEO_H
+
+#include <stdlib.h>
+
+/* ******************************************************************
+ *                DEFINICION DE LOS TIPOS DE DATOS
+ * *****************************************************************/
+
+/* Conteo de votos repartido en fragmentos por hilo. Cada hilo suma en su
+ * propio fragmento, alineado a linea de cache, sin instrucciones atomicas
+ * ni lineas compartidas con otros hilos; al leer se suman los fragmentos.
+ * Los hilos que no tienen fragmento propio (mas de CONTEO_FRAGMENTOS)
+ * comparten uno extra con sumas atomicas. */
+
+typedef struct conteo conteo_t;
+
+#define CONTEO_FRAGMENTOS 32
+
+
+/* ******************************************************************
+ *                    PRIMITIVAS DEL CONTEO
+ * *****************************************************************/
+
+// Crea un conteo con la cantidad de contadores indicada, todos en cero.
+// Post: devuelve NULL en caso de error.
+conteo_t* conteo_crear(size_t contadores);
+
+// Suma uno a cada uno de los contadores indicados, en el fragmento del hilo
+// actual, que se busca una sola vez.
+// Pre: cada contador < cantidad de contadores.
+void conteo_sumar_varios(conteo_t* conteo, const size_t* contadores, size_t cantidad);
+
+// Devuelve el total del contador, sumando todos los fragmentos. Puede
+// llamarse mientras otros hilos suman: ve cada suma entera o no la ve.
+// Pre: contador < cantidad de contadores.
+size_t conteo_total(const conteo_t* conteo, size_t contador);
+
+void conteo_destruir(conteo_t* conteo);
+
+#endif // CONTEO_H
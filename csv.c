@@ -0,0 +1,205 @@
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "csv.h"
+#include "lector.h"
+
+typedef enum {
+    CAMPO_INICIO,
+    SIN_COMILLAS,
+    CON_COMILLAS,
+    // Se leyo una comilla dentro de un campo entre comillas: puede ser el
+    // cierre o la primera de una comilla escapada ("").
+    COMILLA
+} estado_csv_t;
+
+struct csv {
+    lector_t* lector;
+    char separador;
+    estado_csv_t estado;
+    // El registro anterior termino en '\r': si sigue un '\n' es parte del mismo fin de linea
+    bool saltear_salto;
+    bool fallo;
+    // Registro en armado: los campos quedan uno detras de otro, terminados en '\0'
+    char registro[CSV_REGISTRO_MAXIMO];
+    size_t largo;
+    size_t inicio_campo;
+    campo_csv_t campos[CSV_CAMPOS_MAXIMO];
+    size_t cantidad;
+    // Posicion en el bloque actual donde termino el ultimo fin de registro
+    size_t consumido;
+};
+
+csv_t* csv_crear(char separador) {
+    csv_t* csv = malloc(sizeof(csv_t));
+    if(!csv) return NULL;
+
+    csv->lector = NULL;
+    csv->separador = separador;
+    csv->estado = CAMPO_INICIO;
+    csv->saltear_salto = false;
+    csv->fallo = false;
+    csv->largo = 0;
+    csv->inicio_campo = 0;
+    csv->cantidad = 0;
+    csv->consumido = 0;
+    return csv;
+}
+
+csv_t* csv_abrir(const char* nombre, char separador) {
+    csv_t* csv = csv_crear(separador);
+    if(!csv) return NULL;
+
+    csv->lector = lector_abrir(nombre);
+    if(!csv->lector) { free(csv); return NULL; }
+    return csv;
+}
+
+/* Agrega datos al campo actual. Siempre deja lugar para su '\0'. */
+static bool agregar_tramo(csv_t* csv, const char* datos, size_t largo) {
+    if(largo >= CSV_REGISTRO_MAXIMO - csv->largo) return !(csv->fallo = true);
+    memcpy(csv->registro + csv->largo, datos, largo);
+    csv->largo += largo;
+    return true;
+}
+
+static bool cerrar_campo(csv_t* csv) {
+    if(csv->cantidad == CSV_CAMPOS_MAXIMO || csv->largo == CSV_REGISTRO_MAXIMO)
+        return !(csv->fallo = true);
+
+    csv->registro[csv->largo] = '\0';
+    csv->campos[csv->cantidad].dato = csv->registro + csv->inicio_campo;
+    csv->campos[csv->cantidad].largo = csv->largo - csv->inicio_campo;
+    csv->cantidad++;
+    csv->inicio_campo = ++csv->largo;
+    csv->estado = CAMPO_INICIO;
+    return true;
+}
+
+/* Entrega el registro armado y deja el buffer listo para el proximo. */
+static bool terminar_registro(csv_t* csv, visitar_registro_t visitar, void* extra) {
+    // Linea vacia: no tiene ningun campo, ni siquiera uno vacio.
+    bool vacio = csv->estado == CAMPO_INICIO && csv->cantidad == 0;
+    if(!vacio && !cerrar_campo(csv)) return false;
+
+    bool seguir = vacio || visitar(csv->campos, csv->cantidad, extra);
+
+    csv->largo = 0;
+    csv->inicio_campo = 0;
+    csv->cantidad = 0;
+    csv->estado = CAMPO_INICIO;
+    return seguir;
+}
+
+/* Avanza la maquina de estados sobre un bloque. Un registro puede empezar en
+ * un bloque y terminar en otro: el estado y el registro en armado persisten. */
+static bool procesar_bloque(csv_t* csv, const char* bloque, size_t largo, visitar_registro_t visitar, void* extra) {
+    char separador = csv->separador;
+
+    for(size_t i=0;i<largo;i++)
+    {
+        char c = bloque[i];
+
+        if(csv->saltear_salto)
+        {
+            csv->saltear_salto = false;
+            if(c == '\n') continue;
+        }
+
+        if(csv->estado == CON_COMILLAS)
+        {
+            // Todo hasta la proxima comilla es parte del campo, incluso separadores y saltos.
+            const char* comilla = memchr(bloque + i, '"', largo - i);
+            size_t fin = comilla ? (size_t) (comilla - bloque) : largo;
+            if(!agregar_tramo(csv, bloque + i, fin - i)) return false;
+            if(comilla) csv->estado = COMILLA;
+            i = fin;
+            continue;
+        }
+
+        if(csv->estado == COMILLA)
+        {
+            if(c == '"')
+            {
+                if(!agregar_tramo(csv, &c, 1)) return false;
+                csv->estado = CON_COMILLAS;
+                continue;
+            }
+            // Cerro la comilla; lo que siga hasta el separador va tal cual.
+            csv->estado = SIN_COMILLAS;
+        }
+        else if(csv->estado == CAMPO_INICIO && c == '"')
+        {
+            csv->estado = CON_COMILLAS;
+            continue;
+        }
+
+        if(c == separador)
+        {
+            if(!cerrar_campo(csv)) return false;
+        }
+        else if(c == '\n' || c == '\r')
+        {
+            csv->saltear_salto = c == '\r';
+            csv->consumido = i + 1;
+            if(!terminar_registro(csv, visitar, extra)) return false;
+        }
+        else
+        {
+            // Copia de una vez todo el tramo comun del campo.
+            size_t fin = i + 1;
+            while(fin < largo && bloque[fin] != separador && bloque[fin] != '\n' && bloque[fin] != '\r')
+                fin++;
+            if(!agregar_tramo(csv, bloque + i, fin - i)) return false;
+            csv->estado = SIN_COMILLAS;
+            i = fin - 1;
+        }
+    }
+    return true;
+}
+
+bool csv_recorrer(csv_t* csv, visitar_registro_t visitar, void* extra) {
+    const char* bloque;
+    size_t largo;
+
+    while((bloque = lector_siguiente_bloque(csv->lector, &largo)))
+        if(!procesar_bloque(csv, bloque, largo, visitar, extra)) return false;
+
+    if(lector_fallo(csv->lector)) return !(csv->fallo = true);
+
+    // Ultimo registro sin fin de linea (o con una comilla sin cerrar).
+    return terminar_registro(csv, visitar, extra);
+}
+
+/* Registro pedido a csv_siguiente_registro: se entrega y se corta ahi */
+typedef struct registro_pedido {
+    visitar_registro_t visitar;
+    void* extra;
+} registro_pedido_t;
+
+static bool entregar_registro(const campo_csv_t* campos, size_t cantidad, void* extra) {
+    registro_pedido_t* pedido = extra;
+    pedido->visitar(campos, cantidad, pedido->extra);
+    return false;
+}
+
+size_t csv_siguiente_registro(csv_t* csv, const char* datos, size_t largo, visitar_registro_t visitar, void* extra) {
+    registro_pedido_t pedido = { visitar, extra };
+    csv->consumido = largo;
+
+    // Si no corto en un fin de registro, se terminaron los datos.
+    if(procesar_bloque(csv, datos, largo, entregar_registro, &pedido))
+        terminar_registro(csv, entregar_registro, &pedido);
+    return csv->consumido;
+}
+
+bool csv_fallo(const csv_t* csv) {
+    return csv->fallo;
+}
+
+void csv_cerrar(csv_t* csv) {
+    if(!csv) return;
+    lector_cerrar(csv->lector);
+    free(csv);
+}
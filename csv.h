@@ -0,0 +1,67 @@
+#ifndef CSV_H
+#define CSV_H
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+/*
+ * Parser de csv por flujo: recorre el archivo por bloques (con lector_t) y
+ * arma cada registro en un buffer de tamanio fijo, asi la memoria usada no
+ * depende del largo de las lineas ni del tamanio del archivo. Soporta campos
+ * entre comillas (con "" como comilla escapada y saltos de linea adentro),
+ * fines de linea CRLF y registros partidos entre bloques. Las lineas vacias
+ * se saltean.
+ *
+ * Uso:
+ *
+ *    csv_t *csv = csv_abrir("padron.csv", ',');
+ *    csv_recorrer(csv, visitar, extra);
+ *    csv_cerrar(csv);
+ *
+ * Para datos que ya estan en memoria (como un archivo mapeado) se crea con
+ * csv_crear y se lee de a un registro con csv_siguiente_registro.
+ */
+typedef struct csv csv_t;
+
+/* Vista de un campo del registro actual. dato termina en '\0' (ademas de
+ * tener largo) y solo es valido durante el llamado a visitar. */
+typedef struct campo_csv {
+    const char* dato;
+    size_t largo;
+} campo_csv_t;
+
+/* Largo maximo de un registro (sumando sus campos) y cantidad maxima de campos */
+#define CSV_REGISTRO_MAXIMO (64 * 1024)
+#define CSV_CAMPOS_MAXIMO 256
+
+typedef bool (*visitar_registro_t)(const campo_csv_t* campos, size_t cantidad, void* extra);
+
+/* Abre el archivo para recorrerlo.
+ Post: devuelve NULL si no se pudo abrir. */
+csv_t* csv_abrir(const char* nombre, char separador);
+
+/* Crea un parser sin archivo, para csv_siguiente_registro.
+ Post: devuelve NULL en caso de error. */
+csv_t* csv_crear(char separador);
+
+/* Arma el proximo registro de datos (salteando las lineas vacias) y llama a
+ visitar con el, con las mismas reglas que csv_recorrer. Un registro con saltos
+ de linea entre comillas ocupa varias lineas; uno sin fin de linea termina al
+ final de datos.
+ Pre: el parser fue creado con csv_crear y datos sigue a lo ya consumido.
+ Post: devuelve cuantos bytes de datos se consumieron. Si csv_fallo, el
+ registro excedia los limites y no se pueden seguir leyendo registros. */
+size_t csv_siguiente_registro(csv_t* csv, const char* datos, size_t largo, visitar_registro_t visitar, void* extra);
+
+/* Llama a visitar con cada registro, en orden, hasta el final del archivo o
+ hasta que visitar devuelva false.
+ Post: devuelve false si visitar corto el recorrido o si csv_fallo. */
+bool csv_recorrer(csv_t* csv, visitar_registro_t visitar, void* extra);
+
+/* Devuelve true si fallo una lectura o hubo un registro mas largo que
+ CSV_REGISTRO_MAXIMO o con mas de CSV_CAMPOS_MAXIMO campos */
+bool csv_fallo(const csv_t* csv);
+
+void csv_cerrar(csv_t* csv);
+
+#endif // CSV_H
@@ -0,0 +1,161 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include "hash.h"
+
+#define CAPACIDAD_INICIAL 32
+#define FACTOR_CARGA_MAXIMO 0.7
+
+/* Hash cerrado con sondeo lineal. La capacidad es siempre potencia de 2 para
+ * poder reducir el hash con una mascara. Los lugares borrados se marcan con
+ * BORRADO para no cortar las secuencias de sondeo. */
+struct hash {
+    void **tabla;
+    size_t capacidad;
+    size_t cantidad;
+    size_t borrados;
+    hash_funcion_t funcion;
+    hash_iguales_t iguales;
+};
+
+static char marca_borrado;
+#define BORRADO ((void*) &marca_borrado)
+
+static void** crear_tabla(size_t capacidad)
+{
+    return calloc(capacidad, sizeof(void*));
+}
+
+// Devuelve la posicion del dato igual al recibido, o la del primer lugar
+// libre (vacio o borrado) donde podria insertarse.
+static size_t buscar_posicion(const hash_t *hash, const void *dato, bool *encontrado)
+{
+    size_t mascara = hash->capacidad - 1;
+    size_t pos = hash->funcion(dato) & mascara;
+    size_t libre = hash->capacidad;
+
+    *encontrado = false;
+    while(hash->tabla[pos])
+    {
+        if(hash->tabla[pos] == BORRADO)
+        {
+            if(libre == hash->capacidad) libre = pos;
+        }
+        else if(hash->iguales(hash->tabla[pos], dato))
+        {
+            *encontrado = true;
+            return pos;
+        }
+        pos = (pos + 1) & mascara;
+    }
+    return libre == hash->capacidad ? pos : libre;
+}
+
+// Rehashea todos los datos en una tabla de la capacidad indicada.
+static bool redimensionar_hash(hash_t *hash, size_t capacidad)
+{
+    void **tabla_vieja = hash->tabla;
+    size_t capacidad_vieja = hash->capacidad;
+
+    void **tabla = crear_tabla(capacidad);
+    if(!tabla) return false;
+
+    hash->tabla = tabla;
+    hash->capacidad = capacidad;
+    hash->borrados = 0;
+
+    for(size_t i=0;i<capacidad_vieja;i++)
+    {
+        if(!tabla_vieja[i] || tabla_vieja[i] == BORRADO) continue;
+        size_t pos = hash->funcion(tabla_vieja[i]) & (capacidad - 1);
+        while(tabla[pos]) pos = (pos + 1) & (capacidad - 1);
+        tabla[pos] = tabla_vieja[i];
+    }
+    free(tabla_vieja);
+    return true;
+}
+
+hash_t* hash_crear(hash_funcion_t funcion, hash_iguales_t iguales)
+{
+    if(!funcion || !iguales) return NULL;
+
+    hash_t *hash = malloc(sizeof(hash_t));
+    if(!hash) return NULL;
+
+    hash->tabla = crear_tabla(CAPACIDAD_INICIAL);
+    if(!hash->tabla) { free(hash); return NULL; }
+
+    hash->capacidad = CAPACIDAD_INICIAL;
+    hash->cantidad = 0;
+    hash->borrados = 0;
+    hash->funcion = funcion;
+    hash->iguales = iguales;
+    return hash;
+}
+
+void hash_destruir(hash_t *hash, void destruir_dato(void*))
+{
+    if(!hash) return;
+
+    if(destruir_dato)
+        for(size_t i=0;i<hash->capacidad;i++)
+            if(hash->tabla[i] && hash->tabla[i] != BORRADO)
+                destruir_dato(hash->tabla[i]);
+
+    free(hash->tabla);
+    free(hash);
+}
+
+bool hash_guardar(hash_t *hash, void *dato)
+{
+    if(!dato) return false;
+
+    // Se cuentan los borrados porque tambien alargan las secuencias de sondeo.
+    if((double) (hash->cantidad + hash->borrados + 1) > (double) hash->capacidad * FACTOR_CARGA_MAXIMO)
+    {
+        size_t capacidad = hash->capacidad;
+        if((double) (hash->cantidad + 1) > (double) capacidad * FACTOR_CARGA_MAXIMO / 2)
+            capacidad *= 2;
+        if(!redimensionar_hash(hash, capacidad)) return false;
+    }
+
+    bool encontrado;
+    size_t pos = buscar_posicion(hash, dato, &encontrado);
+
+    if(!encontrado)
+    {
+        if(hash->tabla[pos] == BORRADO) hash->borrados--;
+        hash->cantidad++;
+    }
+    hash->tabla[pos] = dato;
+    return true;
+}
+
+void* hash_obtener(const hash_t *hash, const void *dato)
+{
+    bool encontrado;
+    size_t pos = buscar_posicion(hash, dato, &encontrado);
+    return encontrado ? hash->tabla[pos] : NULL;
+}
+
+bool hash_pertenece(const hash_t *hash, const void *dato)
+{
+    return hash_obtener(hash, dato) != NULL;
+}
+
+void* hash_borrar(hash_t *hash, const void *dato)
+{
+    bool encontrado;
+    size_t pos = buscar_posicion(hash, dato, &encontrado);
+    if(!encontrado) return NULL;
+
+    void *guardado = hash->tabla[pos];
+    hash->tabla[pos] = BORRADO;
+    hash->cantidad--;
+    hash->borrados++;
+    return guardado;
+}
+
+size_t hash_cantidad(const hash_t *hash)
+{
+    return hash->cantidad;
+}
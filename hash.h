@@ -0,0 +1,58 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <stdlib.h>
+#include <stdbool.h>
+
+
+/* ******************************************************************
+ *                DEFINICION DE LOS TIPOS DE DATOS
+ * *****************************************************************/
+
+/* El hash está planteado como un conjunto de punteros genéricos: cada dato
+ * es su propia clave, y el usuario provee la función de hashing y la de
+ * comparación. Los datos no pueden ser NULL. */
+
+typedef struct hash hash_t;
+
+typedef size_t (*hash_funcion_t)(const void *dato);
+typedef bool (*hash_iguales_t)(const void *a, const void *b);
+
+
+/* ******************************************************************
+ *                    PRIMITIVAS DEL HASH
+ * *****************************************************************/
+
+// Crea un hash.
+// Pre: funcion e iguales son coherentes (datos iguales tienen igual hash).
+// Post: devuelve un nuevo hash vacío, o NULL en caso de error.
+hash_t* hash_crear(hash_funcion_t funcion, hash_iguales_t iguales);
+
+// Destruye el hash. Si se recibe la función destruir_dato por parámetro,
+// para cada uno de los elementos del hash llama a destruir_dato.
+// Pre: el hash fue creado.
+// Post: se eliminaron todos los elementos del hash.
+void hash_destruir(hash_t *hash, void destruir_dato(void*));
+
+// Guarda un dato en el hash. Si ya había uno igual, lo reemplaza.
+// Devuelve falso en caso de error.
+// Pre: el hash fue creado, dato no es NULL.
+bool hash_guardar(hash_t *hash, void *dato);
+
+// Devuelve el dato guardado igual al recibido, o NULL si no pertenece.
+// Pre: el hash fue creado.
+void* hash_obtener(const hash_t *hash, const void *dato);
+
+// Devuelve verdadero si hay un dato igual al recibido en el hash.
+// Pre: el hash fue creado.
+bool hash_pertenece(const hash_t *hash, const void *dato);
+
+// Quita del hash el dato igual al recibido y lo devuelve, o NULL si no estaba.
+// Pre: el hash fue creado.
+void* hash_borrar(hash_t *hash, const void *dato);
+
+// Devuelve la cantidad de datos guardados.
+// Pre: el hash fue creado.
+size_t hash_cantidad(const hash_t *hash);
+
+#endif // HASH_H
@@ -0,0 +1,311 @@
+#define _DEFAULT_SOURCE
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define LECTOR_IO_URING
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#endif
+#endif
+
+#include "lector.h"
+
+#define TAM_BLOQUE (1 << 20)
+#define ALINEACION 4096
+#define CANTIDAD_BUFFERS 2
+
+typedef struct buffer {
+    char* datos;
+    // Posicion del bloque en el archivo
+    off_t desplazamiento;
+    // Bytes leidos, o negativo si la lectura fallo
+    ssize_t leidos;
+    // Tiene un bloque asignado (false pasado el final del archivo)
+    bool asignado;
+    // La lectura del bloque todavia no termino
+    bool pendiente;
+} buffer_t;
+
+#ifdef LECTOR_IO_URING
+/* Anillos de envio y de terminacion de io_uring, mapeados del kernel */
+typedef struct anillo {
+    int fd;
+    unsigned *sq_cola, *sq_mascara, *sq_arreglo;
+    unsigned *cq_cabeza, *cq_cola, *cq_mascara;
+    struct io_uring_sqe* sqes;
+    struct io_uring_cqe* cqes;
+    void* sq_mapa;
+    size_t sq_largo;
+    void* cq_mapa;
+    size_t cq_largo;
+    size_t sqes_largo;
+} anillo_t;
+#endif
+
+struct lector {
+    int fd;
+    off_t tam_archivo;
+    // Proxima posicion del archivo a asignar a un buffer
+    off_t proximo;
+    buffer_t buffers[CANTIDAD_BUFFERS];
+    // Buffer del proximo bloque a entregar
+    size_t actual;
+    // Se entrego un bloque que hay que reciclar en el proximo llamado
+    bool entregado;
+    bool fallo;
+    #ifdef LECTOR_IO_URING
+    // NULL si io_uring no esta disponible
+    anillo_t* anillo;
+    #endif
+};
+
+#ifdef LECTOR_IO_URING
+static void anillo_destruir(anillo_t* anillo) {
+    if(anillo->sqes) munmap(anillo->sqes, anillo->sqes_largo);
+    if(anillo->cq_mapa && anillo->cq_mapa != anillo->sq_mapa) munmap(anillo->cq_mapa, anillo->cq_largo);
+    if(anillo->sq_mapa) munmap(anillo->sq_mapa, anillo->sq_largo);
+    close(anillo->fd);
+    free(anillo);
+}
+
+/* Crea un io_uring chico. Devuelve NULL si el kernel no lo soporta o no lo permite. */
+static anillo_t* anillo_crear(void) {
+    struct io_uring_params parametros;
+    memset(&parametros, 0, sizeof(parametros));
+
+    int fd = (int) syscall(__NR_io_uring_setup, CANTIDAD_BUFFERS, &parametros);
+    if(fd < 0) return NULL;
+
+    anillo_t* anillo = calloc(1, sizeof(anillo_t));
+    if(!anillo) { close(fd); return NULL; }
+    anillo->fd = fd;
+
+    anillo->sq_largo = parametros.sq_off.array + parametros.sq_entries * sizeof(unsigned);
+    anillo->cq_largo = parametros.cq_off.cqes + parametros.cq_entries * sizeof(struct io_uring_cqe);
+    if(parametros.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        if(anillo->cq_largo > anillo->sq_largo) anillo->sq_largo = anillo->cq_largo;
+        anillo->cq_largo = anillo->sq_largo;
+    }
+
+    anillo->sq_mapa = mmap(NULL, anillo->sq_largo, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if(anillo->sq_mapa == MAP_FAILED) { anillo->sq_mapa = NULL; anillo_destruir(anillo); return NULL; }
+
+    if(parametros.features & IORING_FEAT_SINGLE_MMAP)
+        anillo->cq_mapa = anillo->sq_mapa;
+    else
+    {
+        anillo->cq_mapa = mmap(NULL, anillo->cq_largo, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if(anillo->cq_mapa == MAP_FAILED) { anillo->cq_mapa = NULL; anillo_destruir(anillo); return NULL; }
+    }
+
+    anillo->sqes_largo = parametros.sq_entries * sizeof(struct io_uring_sqe);
+    anillo->sqes = mmap(NULL, anillo->sqes_largo, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if(anillo->sqes == MAP_FAILED) { anillo->sqes = NULL; anillo_destruir(anillo); return NULL; }
+
+    char* sq = anillo->sq_mapa;
+    char* cq = anillo->cq_mapa;
+    anillo->sq_cola = (unsigned*) (sq + parametros.sq_off.tail);
+    anillo->sq_mascara = (unsigned*) (sq + parametros.sq_off.ring_mask);
+    anillo->sq_arreglo = (unsigned*) (sq + parametros.sq_off.array);
+    anillo->cq_cabeza = (unsigned*) (cq + parametros.cq_off.head);
+    anillo->cq_cola = (unsigned*) (cq + parametros.cq_off.tail);
+    anillo->cq_mascara = (unsigned*) (cq + parametros.cq_off.ring_mask);
+    anillo->cqes = (struct io_uring_cqe*) (cq + parametros.cq_off.cqes);
+    return anillo;
+}
+
+/* Envia la lectura del buffer. Devuelve false si no se pudo enviar. */
+static bool anillo_leer(anillo_t* anillo, int fd, buffer_t* buffer, size_t indice) {
+    unsigned cola = *anillo->sq_cola;
+    unsigned posicion = cola & *anillo->sq_mascara;
+
+    struct io_uring_sqe* sqe = &anillo->sqes[posicion];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t) (uintptr_t) buffer->datos;
+    sqe->len = TAM_BLOQUE;
+    sqe->off = (uint64_t) buffer->desplazamiento;
+    sqe->user_data = indice;
+
+    anillo->sq_arreglo[posicion] = posicion;
+    __atomic_store_n(anillo->sq_cola, cola + 1, __ATOMIC_RELEASE);
+
+    return syscall(__NR_io_uring_enter, anillo->fd, 1, 0, 0, NULL, 0) == 1;
+}
+
+/* Procesa terminaciones hasta que el buffer indicado deje de estar pendiente */
+static bool anillo_esperar(lector_t* lector, size_t indice) {
+    anillo_t* anillo = lector->anillo;
+
+    while(lector->buffers[indice].pendiente)
+    {
+        unsigned cabeza = *anillo->cq_cabeza;
+        unsigned cola = __atomic_load_n(anillo->cq_cola, __ATOMIC_ACQUIRE);
+
+        if(cabeza == cola)
+        {
+            if(syscall(__NR_io_uring_enter, anillo->fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0) < 0)
+                return false;
+            continue;
+        }
+
+        for(;cabeza != cola;cabeza++)
+        {
+            struct io_uring_cqe* cqe = &anillo->cqes[cabeza & *anillo->cq_mascara];
+            buffer_t* buffer = &lector->buffers[cqe->user_data];
+            buffer->leidos = cqe->res;
+            buffer->pendiente = false;
+        }
+        __atomic_store_n(anillo->cq_cabeza, cabeza, __ATOMIC_RELEASE);
+    }
+    return true;
+}
+#endif
+
+/* Asigna al buffer el proximo bloque del archivo y empieza a leerlo */
+static void encolar_bloque(lector_t* lector, size_t indice) {
+    buffer_t* buffer = &lector->buffers[indice];
+
+    buffer->asignado = lector->proximo < lector->tam_archivo;
+    buffer->pendiente = buffer->asignado;
+    buffer->leidos = 0;
+    if(!buffer->asignado) return;
+
+    buffer->desplazamiento = lector->proximo;
+    lector->proximo += TAM_BLOQUE;
+
+    #ifdef LECTOR_IO_URING
+    if(lector->anillo && anillo_leer(lector->anillo, lector->fd, buffer, indice))
+        return;
+    if(lector->anillo)
+    {
+        // Sin io_uring para esta lectura: se sigue con pread. Antes de cerrar el
+        // anillo terminan las lecturas de los otros buffers, que ya estan en
+        // camino; lo que traigan no se vuelve a leer.
+        buffer->pendiente = false;
+        for(size_t i=0;i<CANTIDAD_BUFFERS;i++)
+            if(lector->buffers[i].pendiente && !anillo_esperar(lector, i))
+                lector->fallo = true;
+        anillo_destruir(lector->anillo);
+        lector->anillo = NULL;
+    }
+    #endif
+
+    // Con pread la lectura recien se hace al esperar el bloque: se le pide al
+    // kernel que lo vaya trayendo mientras tanto.
+    posix_fadvise(lector->fd, buffer->desplazamiento, TAM_BLOQUE, POSIX_FADV_WILLNEED);
+}
+
+/* Espera a que el bloque del buffer este leido completo */
+static bool esperar_bloque(lector_t* lector, size_t indice) {
+    buffer_t* buffer = &lector->buffers[indice];
+
+    #ifdef LECTOR_IO_URING
+    if(buffer->pendiente && lector->anillo && !anillo_esperar(lector, indice))
+        return false;
+    #endif
+
+    if(buffer->pendiente || buffer->leidos < 0)
+    {
+        buffer->leidos = 0;
+        buffer->pendiente = false;
+    }
+
+    // Completa con pread lo que falte (lecturas cortas, o sin io_uring).
+    off_t esperado = lector->tam_archivo - buffer->desplazamiento;
+    if(esperado > TAM_BLOQUE) esperado = TAM_BLOQUE;
+
+    while(buffer->leidos < esperado)
+    {
+        ssize_t leidos = pread(lector->fd, buffer->datos + buffer->leidos, (size_t) (esperado - buffer->leidos), buffer->desplazamiento + buffer->leidos);
+        if(leidos <= 0) return false;
+        buffer->leidos += leidos;
+    }
+    return true;
+}
+
+lector_t* lector_abrir(const char* nombre) {
+    int fd = open(nombre, O_RDONLY);
+    if(fd < 0) return NULL;
+
+    struct stat datos;
+    lector_t* lector = fstat(fd, &datos) == 0 ? calloc(1, sizeof(lector_t)) : NULL;
+    if(!lector) { close(fd); return NULL; }
+
+    lector->fd = fd;
+    lector->tam_archivo = datos.st_size;
+
+    for(size_t i=0;i<CANTIDAD_BUFFERS;i++)
+    {
+        void* datos_buffer;
+        if(posix_memalign(&datos_buffer, ALINEACION, TAM_BLOQUE) != 0) { lector_cerrar(lector); return NULL; }
+        lector->buffers[i].datos = datos_buffer;
+    }
+
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    #ifdef LECTOR_IO_URING
+    lector->anillo = anillo_crear();
+    #endif
+
+    for(size_t i=0;i<CANTIDAD_BUFFERS;i++)
+        encolar_bloque(lector, i);
+
+    return lector;
+}
+
+const char* lector_siguiente_bloque(lector_t* lector, size_t* largo) {
+    // El bloque entregado antes ya se proceso: su buffer pasa a leer el que sigue.
+    if(lector->entregado)
+        encolar_bloque(lector, (lector->actual + CANTIDAD_BUFFERS - 1) % CANTIDAD_BUFFERS);
+    lector->entregado = false;
+
+    buffer_t* buffer = &lector->buffers[lector->actual];
+    if(lector->fallo || !buffer->asignado) return NULL;
+
+    if(!esperar_bloque(lector, lector->actual))
+    {
+        lector->fallo = true;
+        return NULL;
+    }
+
+    lector->actual = (lector->actual + 1) % CANTIDAD_BUFFERS;
+    lector->entregado = true;
+    *largo = (size_t) buffer->leidos;
+    return buffer->datos;
+}
+
+bool lector_fallo(const lector_t* lector) {
+    return lector->fallo;
+}
+
+void lector_cerrar(lector_t* lector) {
+    if(!lector) return;
+
+    #ifdef LECTOR_IO_URING
+    if(lector->anillo)
+    {
+        // El kernel todavia puede estar escribiendo en los buffers.
+        for(size_t i=0;i<CANTIDAD_BUFFERS;i++)
+            if(lector->buffers[i].pendiente && lector->buffers[i].datos) anillo_esperar(lector, i);
+        anillo_destruir(lector->anillo);
+    }
+    #endif
+
+    for(size_t i=0;i<CANTIDAD_BUFFERS;i++)
+        free(lector->buffers[i].datos);
+    close(lector->fd);
+    free(lector);
+}
@@ -0,0 +1,35 @@
+#ifndef LECTOR_H
+#define LECTOR_H
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+/*
+ * Lector de archivos por bloques grandes con doble buffer: mientras se procesa
+ * un bloque, el siguiente ya se esta leyendo. Usa io_uring cuando el sistema
+ * lo tiene, y si no pread con aviso de lectura anticipada al kernel.
+ *
+ * Uso:
+ *
+ *    lector_t *lector = lector_abrir("padron.csv");
+ *    const char *bloque;
+ *    size_t largo;
+ *    while ((bloque = lector_siguiente_bloque(lector, &largo))) { ... }
+ *    lector_cerrar(lector);
+ */
+typedef struct lector lector_t;
+
+/* Abre el archivo y encola la lectura de los primeros bloques.
+ Post: devuelve NULL si no se pudo abrir. */
+lector_t* lector_abrir(const char* nombre);
+
+/* Devuelve el proximo bloque del archivo y su largo en *largo, o NULL al
+ llegar al final o ante un error. El bloque es valido hasta el proximo llamado. */
+const char* lector_siguiente_bloque(lector_t* lector, size_t* largo);
+
+/* Devuelve true si alguna lectura fallo */
+bool lector_fallo(const lector_t* lector);
+
+void lector_cerrar(lector_t* lector);
+
+#endif // LECTOR_H
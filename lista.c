@@ -1,28 +1,115 @@
 #include <stdlib.h>
+#include <string.h>
 #include "lista.h"
 #include <stdbool.h>
 
-typedef struct nodo {
-	void* dato;
-	struct nodo* siguiente;
+// Elementos por nodo: un recorrido lee los punteros seguidos, como en un
+// arreglo, y salta de nodo cada tantos elementos.
+#define ELEMENTOS_POR_NODO 32
+#define MITAD_NODO (ELEMENTOS_POR_NODO / 2)
+
+/* Lista desenrollada: cada nodo guarda varios elementos consecutivos. Ningun
+ * nodo de la lista queda vacio. Los nodos se enlazan en los dos sentidos
+ * para poder quitar uno desde un iterador. */
+typedef struct lista_nodo {
+	struct lista_nodo* anterior;
+	struct lista_nodo* siguiente;
+	size_t cantidad;
+	void* datos[ELEMENTOS_POR_NODO];
 } nodo_t;
 
 struct lista {
 	nodo_t* primero;
 	nodo_t* ultimo;
 	size_t largo;
+	// De donde salen los nodos: propio de la lista o compartido
+	almacen_nodos_t* almacen;
+	bool almacen_propio;
 };
 
-struct lista_iter
+/* Pide un nodo vacio y lo enlaza despues de anterior (al principio si es NULL) */
+static nodo_t* nodo_agregar(lista_t* lista, nodo_t* anterior)
 {
-	nodo_t* nodo_ant;
-	nodo_t* nodo_act;
-};
+	nodo_t* nodo = almacen_pedir(lista->almacen);
+	if(!nodo)
+		return NULL;
+
+	nodo->cantidad = 0;
+	nodo->anterior = anterior;
+	nodo->siguiente = anterior ? anterior->siguiente : lista->primero;
+
+	if(anterior)
+		anterior->siguiente = nodo;
+	else
+		lista->primero = nodo;
+
+	if(nodo->siguiente)
+		nodo->siguiente->anterior = nodo;
+	else
+		lista->ultimo = nodo;
+	return nodo;
+}
+
+/* Desenlaza el nodo y lo devuelve al almacen */
+static void nodo_quitar(lista_t* lista, nodo_t* nodo)
+{
+	if(nodo->anterior)
+		nodo->anterior->siguiente = nodo->siguiente;
+	else
+		lista->primero = nodo->siguiente;
+
+	if(nodo->siguiente)
+		nodo->siguiente->anterior = nodo->anterior;
+	else
+		lista->ultimo = nodo->anterior;
+
+	almacen_devolver(lista->almacen, nodo);
+}
+
+/* Inserta el dato en la posicion indice del nodo, corriendo los siguientes.
+ * Pre: el nodo no esta lleno. */
+static void nodo_insertar(nodo_t* nodo, size_t indice, void* dato)
+{
+	memmove(&nodo->datos[indice + 1], &nodo->datos[indice], (nodo->cantidad - indice) * sizeof(void*));
+	nodo->datos[indice] = dato;
+	nodo->cantidad++;
+}
+
+/* Saca el dato de la posicion indice del nodo, corriendo los siguientes */
+static void* nodo_borrar(nodo_t* nodo, size_t indice)
+{
+	void* dato = nodo->datos[indice];
+	nodo->cantidad--;
+	memmove(&nodo->datos[indice], &nodo->datos[indice + 1], (nodo->cantidad - indice) * sizeof(void*));
+	return dato;
+}
 
 // Crea una lista.
 // Post: devuelve una nueva lista vacía.
 lista_t* lista_crear(void)
 {
+    almacen_nodos_t* almacen = almacen_crear(lista_tamanio_nodo());
+    if(!almacen)
+        return NULL;
+
+    lista_t* lista = lista_crear_en(almacen);
+    if(!lista)
+    {
+        almacen_destruir(almacen);
+        return NULL;
+    }
+
+    lista->almacen_propio = true;
+    return lista;
+}
+
+// Crea una lista que toma sus nodos del almacen indicado.
+// Post: devuelve una nueva lista vacía, o NULL en caso de error.
+lista_t* lista_crear_en(almacen_nodos_t* almacen)
+{
+    if(!almacen || almacen_tamanio(almacen) < sizeof(nodo_t))
+        return NULL;
+
     lista_t* lista = malloc(sizeof(lista_t));
 
     if(!lista)
@@ -31,10 +118,34 @@ lista_t* lista_crear(void)
     lista->primero = NULL;
     lista->ultimo = NULL;
     lista->largo = 0;
+    lista->almacen = almacen;
+    lista->almacen_propio = false;
 
     return lista;
 }
 
+// Devuelve el tamanio de los nodos que usa una lista.
+size_t lista_tamanio_nodo(void)
+{
+	return sizeof(nodo_t);
+}
+
+// Crea una lista con los elementos del arreglo, en orden.
+// Post: devuelve una nueva lista, o NULL en caso de error.
+lista_t* lista_crear_desde(void* const* datos, size_t cantidad)
+{
+	lista_t* lista = lista_crear();
+	if(!lista)
+		return NULL;
+
+	if(!lista_insertar_varios(lista, datos, cantidad))
+	{
+		lista_destruir(lista, NULL);
+		return NULL;
+	}
+	return lista;
+}
+
 // Destruye la lista. Si se recibe la función destruir_dato por parámetro,
 // para cada uno de los elementos de la lista llama a destruir_dato.
 // Pre: la lista fue creada. destruir_dato es una función capaz de destruir
@@ -42,11 +153,17 @@ lista_t* lista_crear(void)
 // Post: se eliminaron todos los elementos de la lista.
 void lista_destruir(lista_t *lista, void destruir_dato(void*))
 {
-	while(!lista_esta_vacia(lista))
-        	if(destruir_dato!=NULL)
-				destruir_dato(lista_borrar_primero(lista));
-		else
-			lista_borrar_primero(lista);
+	while(lista->primero)
+	{
+		nodo_t* nodo = lista->primero;
+		if(destruir_dato != NULL)
+			for(size_t i=0;i<nodo->cantidad;i++)
+				destruir_dato(nodo->datos[i]);
+		nodo_quitar(lista, nodo);
+	}
+
+	if(lista->almacen_propio)
+		almacen_destruir(lista->almacen);
 	free(lista);
 }
 
@@ -63,19 +180,15 @@ bool lista_esta_vacia(const lista_t *lista)
 // de la lista.
 bool lista_insertar_primero(lista_t *lista, void* valor)
 {
-	nodo_t* nodo = malloc(sizeof(nodo_t));
+	nodo_t* nodo = lista->primero;
 
+	if(!nodo || nodo->cantidad == ELEMENTOS_POR_NODO)
+		nodo = nodo_agregar(lista, NULL);
 	if(nodo == NULL)
 		return false;
 
+	nodo_insertar(nodo, 0, valor);
 	lista->largo++;
-	nodo->siguiente = lista->primero;
-	nodo->dato = valor;
-
-	if(lista_esta_vacia(lista))
-		lista->ultimo = nodo;
-
-	lista->primero = nodo;
 	return true;
 }
 
@@ -85,30 +198,103 @@ bool lista_insertar_primero(lista_t *lista, void* valor)
 // de la lista.
 bool lista_insertar_ultimo(lista_t *lista, void* valor)
 {
-    if(lista_esta_vacia(lista))
-        return lista_insertar_primero(lista, valor);
-
-	nodo_t* nodo = malloc(sizeof(nodo_t));
-	nodo->dato = valor;
-    nodo->siguiente = NULL;
+	nodo_t* nodo = lista->ultimo;
 
+	if(!nodo || nodo->cantidad == ELEMENTOS_POR_NODO)
+		nodo = nodo_agregar(lista, lista->ultimo);
 	if(nodo == NULL)
 		return false;
 
-    lista->ultimo->siguiente = nodo;
-	lista->ultimo = nodo;
+	nodo->datos[nodo->cantidad++] = valor;
 	lista->largo++;
+	return true;
+}
+
+// Agrega los elementos del arreglo al final de la lista, en orden.
+// Post: devuelve false en caso de error, sin modificar la lista.
+bool lista_insertar_varios(lista_t *lista, void* const* datos, size_t cantidad)
+{
+	nodo_t* ultimo = lista->ultimo;
+	size_t lugar = ultimo ? ELEMENTOS_POR_NODO - ultimo->cantidad : 0;
+	size_t faltan = cantidad > lugar ? cantidad - lugar : 0;
+
+	// Primero se piden todos los nodos que faltan, encadenados aparte: si no
+	// hay memoria, la lista queda como estaba.
+	nodo_t* nuevos = NULL;
+	nodo_t* ultimo_nuevo = NULL;
+	for(size_t pedidos=0;pedidos*ELEMENTOS_POR_NODO<faltan;pedidos++)
+	{
+		nodo_t* nodo = almacen_pedir(lista->almacen);
+		if(!nodo)
+		{
+			while(nuevos)
+			{
+				nodo_t* siguiente = nuevos->siguiente;
+				almacen_devolver(lista->almacen, nuevos);
+				nuevos = siguiente;
+			}
+			return false;
+		}
+
+		nodo->anterior = ultimo_nuevo;
+		nodo->siguiente = NULL;
+		if(ultimo_nuevo)
+			ultimo_nuevo->siguiente = nodo;
+		else
+			nuevos = nodo;
+		ultimo_nuevo = nodo;
+	}
+
+	// Se completa el ultimo nodo y se llenan los nuevos de a bloques.
+	size_t copiados = cantidad < lugar ? cantidad : lugar;
+	if(copiados)
+	{
+		memcpy(&ultimo->datos[ultimo->cantidad], datos, copiados * sizeof(void*));
+		ultimo->cantidad += copiados;
+	}
+	for(nodo_t* nodo = nuevos; nodo; nodo = nodo->siguiente)
+	{
+		size_t bloque = cantidad - copiados < ELEMENTOS_POR_NODO ? cantidad - copiados : ELEMENTOS_POR_NODO;
+		memcpy(nodo->datos, &datos[copiados], bloque * sizeof(void*));
+		nodo->cantidad = bloque;
+		copiados += bloque;
+	}
+
+	if(nuevos)
+	{
+		nuevos->anterior = ultimo;
+		if(ultimo)
+			ultimo->siguiente = nuevos;
+		else
+			lista->primero = nuevos;
+		lista->ultimo = ultimo_nuevo;
+	}
 
+	lista->largo += cantidad;
 	return true;
 }
 
+// Copia en destino los primeros elementos de la lista, hasta capacidad.
+// Post: devuelve la cantidad de elementos copiados.
+size_t lista_exportar(const lista_t *lista, void** destino, size_t capacidad)
+{
+	size_t copiados = 0;
+	for(nodo_t* nodo = lista->primero; nodo && copiados < capacidad; nodo = nodo->siguiente)
+	{
+		size_t bloque = capacidad - copiados < nodo->cantidad ? capacidad - copiados : nodo->cantidad;
+		memcpy(&destino[copiados], nodo->datos, bloque * sizeof(void*));
+		copiados += bloque;
+	}
+	return copiados;
+}
+
 // Obtiene el valor del primer elemento de la lista. Si la lista tiene
 // elementos, se devuelve el valor del primero, si está vacía devuelve NULL.
 // Pre: la lista fue creada.
 // Post: se devolvió el primer elemento de la lista, cuando no está vacía.
 void* lista_ver_primero(const lista_t *lista)
 {
-	return (!lista_esta_vacia(lista)) ? lista->primero->dato : NULL;
+	return (!lista_esta_vacia(lista)) ? lista->primero->datos[0] : NULL;
 }
 
 // Saca el primer elemento de la lista. Si la lista tiene elementos, se quita el
@@ -121,12 +307,12 @@ void* lista_borrar_primero(lista_t *lista)
 	if(lista_esta_vacia(lista))
 		return NULL;
 
-	void* dato = lista_ver_primero(lista);
+	nodo_t* nodo = lista->primero;
+	void* dato = nodo_borrar(nodo, 0);
+	if(!nodo->cantidad)
+		nodo_quitar(lista, nodo);
 
-	nodo_t* nuevo_primero = lista->primero->siguiente;
-	free(lista->primero);
 	lista->largo--;
-	lista->primero = nuevo_primero;
 	return dato;
 }
 
@@ -146,12 +332,18 @@ lista_iter_t *lista_iter_crear(const lista_t *lista)
     lista_iter_t* iter = malloc(sizeof(lista_iter_t));
 	if(!iter) return NULL;
 
-	iter->nodo_ant = NULL;
-	iter->nodo_act = lista->primero;
-
+	lista_iter_iniciar(iter, lista);
 	return iter;
 }
 
+// Posiciona en el primer elemento de la lista un iterador que reservo el llamador.
+// Pre: la lista fue creada.
+void lista_iter_iniciar(lista_iter_t *iter, const lista_t *lista)
+{
+	iter->nodo_act = lista->primero;
+	iter->indice = 0;
+}
+
 // Devuelve si el iterador se encuentra despues del ultimo elemento en la lista
 // Pre: el iterador fue creado
 // Post: se devolvio NULL si el iter no fue creado
@@ -169,8 +361,12 @@ bool lista_iter_avanzar(lista_iter_t *iter)
 	if(!iter || lista_iter_al_final(iter))
 		return false;
 
-	iter->nodo_ant = iter->nodo_act;
-	iter->nodo_act = iter->nodo_act->siguiente;
+	iter->indice++;
+	if(iter->indice == iter->nodo_act->cantidad)
+	{
+		iter->nodo_act = iter->nodo_act->siguiente;
+		iter->indice = 0;
+	}
 	return true;
 }
 
@@ -182,7 +378,7 @@ void* lista_iter_ver_actual(const lista_iter_t *iter)
 	if(!iter || lista_iter_al_final(iter))
 		return NULL;
 
-	return iter->nodo_act->dato;
+	return iter->nodo_act->datos[iter->indice];
 }
 
 // Destruye el iterador de una lista
@@ -201,33 +397,38 @@ bool lista_insertar(lista_t *lista, lista_iter_t *iter, void *dato)
 	if(!lista || !iter || !dato)
 		return false;
 
-    // Caso 1: Iter al principio de la lista
-	if(!iter->nodo_ant)
+	// Caso 1: Iter al final, se agrega como ultimo
+	if(lista_iter_al_final(iter))
 	{
-		if(!lista_insertar_primero(lista, dato))
+		if(!lista_insertar_ultimo(lista, dato))
 			return false;
-		iter->nodo_act = lista->primero;
-		iter->nodo_ant = NULL;
+		iter->nodo_act = lista->ultimo;
+		iter->indice = lista->ultimo->cantidad - 1;
 		return true;
 	}
 
-	nodo_t* nodo = malloc(sizeof(nodo_t));
-    if(nodo == NULL) return false;
+	// Caso 2: Nodo lleno, se parte a la mitad y el iterador queda en la que
+	// le toque
+	nodo_t* nodo = iter->nodo_act;
+	if(nodo->cantidad == ELEMENTOS_POR_NODO)
+	{
+		nodo_t* nuevo = nodo_agregar(lista, nodo);
+		if(!nuevo)
+			return false;
 
-    nodo->dato = dato;
+		memcpy(nuevo->datos, &nodo->datos[MITAD_NODO], (ELEMENTOS_POR_NODO - MITAD_NODO) * sizeof(void*));
+		nuevo->cantidad = ELEMENTOS_POR_NODO - MITAD_NODO;
+		nodo->cantidad = MITAD_NODO;
 
-	// Caso 2: Iter al final
-	if(lista_iter_al_final(iter))
-    {
-        nodo->siguiente = NULL;
-        lista->ultimo = nodo;
-    }
-    else // Caso 3: Iter entre dos nodos
-        nodo->siguiente = iter->nodo_act;
-
-    iter->nodo_ant->siguiente = nodo;
-    iter->nodo_act = nodo;
+		if(iter->indice > MITAD_NODO)
+		{
+			iter->nodo_act = nuevo;
+			iter->indice -= MITAD_NODO;
+		}
+	}
 
+	// Caso 3: Lugar en el nodo actual
+	nodo_insertar(iter->nodo_act, iter->indice, dato);
 	lista->largo++;
 	return true;
 }
@@ -241,27 +442,23 @@ void* lista_borrar(lista_t *lista, lista_iter_t *iter)
 		return NULL;
 
     nodo_t *nodo = iter->nodo_act;
-    void *dato = nodo->dato;
+    void *dato = nodo_borrar(nodo, iter->indice);
+    lista->largo--;
 
-    // Caso 1: Iter al principio de la lista
-    if(iter->nodo_ant == NULL)
+    // El nodo quedo vacio: se quita y el iterador pasa al siguiente
+    if(!nodo->cantidad)
     {
-
-        lista->primero = iter->nodo_act->siguiente;
-        iter->nodo_act = lista->primero;
+        iter->nodo_act = nodo->siguiente;
+        iter->indice = 0;
+        nodo_quitar(lista, nodo);
     }
-    else
+    // Se borro el ultimo elemento del nodo: el actual es el primero del siguiente
+    else if(iter->indice == nodo->cantidad)
     {
-        iter->nodo_ant->siguiente = iter->nodo_act->siguiente;
-        iter->nodo_act = iter->nodo_ant->siguiente;
+        iter->nodo_act = nodo->siguiente;
+        iter->indice = 0;
     }
 
-    free(nodo);
-    lista->largo--;
-
-    if(lista_largo(lista)==1)
-        lista->ultimo = lista->primero;
-
     return dato;
 }
 
@@ -272,22 +469,9 @@ void lista_iterar(lista_t *lista, bool (*visitar)(void *dato, void *extra), void
     if(!lista || !visitar || !extra)
 		return;
 
-    lista_iter_t *iter = lista_iter_crear(lista);
-
-    if(!iter)
-        return;
-
-    while( !lista_iter_al_final(iter) && visitar(lista_iter_ver_actual(iter), extra) )
-       lista_iter_avanzar(iter);
-
-    lista_iter_destruir(iter);
-
+    // Sin iterador: los datos de cada nodo se recorren como un arreglo.
+    for(nodo_t* nodo = lista->primero; nodo; nodo = nodo->siguiente)
+        for(size_t i=0;i<nodo->cantidad;i++)
+            if(!visitar(nodo->datos[i], extra))
+                return;
 }
-
-
-
-
-
-
-
-
@@ -4,17 +4,27 @@
 #include <stdlib.h>
 #include <stdbool.h>
 
+#include "nodos.h"
+
 
 /* ******************************************************************
  *                DEFINICION DE LOS TIPOS DE DATOS
  * *****************************************************************/
 
-/* La lista está planteada como una lista de punteros genéricos. */
+/* La lista está planteada como una lista de punteros genéricos, guardados de a
+ * varios por nodo (lista desenrollada). */
 
 //struct lista;
 typedef struct lista lista_t;
 
-typedef struct lista_iter lista_iter_t;
+/* El iterador se puede pedir con lista_iter_crear, o declarar en el stack e
+ * iniciar con lista_iter_iniciar sin reservar memoria. Sus campos son privados
+ * de la lista. */
+struct lista_nodo;
+typedef struct lista_iter {
+	struct lista_nodo* nodo_act;
+	size_t indice;
+} lista_iter_t;
 
 
 /* ******************************************************************
@@ -25,6 +35,19 @@ typedef struct lista_iter lista_iter_t;
 // Post: devuelve una nueva lista vacía.
 lista_t* lista_crear(void);
 
+// Crea una lista que toma sus nodos del almacen indicado, que puede compartir
+// con otras listas. El almacen debe tener nodos de al menos
+// lista_tamanio_nodo() bytes y se destruye despues que la lista.
+// Post: devuelve una nueva lista vacía, o NULL en caso de error.
+lista_t* lista_crear_en(almacen_nodos_t* almacen);
+
+// Devuelve el tamanio de los nodos que usa una lista.
+size_t lista_tamanio_nodo(void);
+
+// Crea una lista con los cantidad elementos del arreglo datos, en orden.
+// Post: devuelve una nueva lista, o NULL en caso de error.
+lista_t* lista_crear_desde(void* const* datos, size_t cantidad);
+
 // Destruye la lista. Si se recibe la función destruir_dato por parámetro,
 // para cada uno de los elementos de la lista llama a destruir_dato.
 // Pre: la lista fue creada. destruir_dato es una función capaz de destruir
@@ -48,6 +71,18 @@ bool lista_insertar_primero(lista_t *lista, void *dato);
 // de la lista.
 bool lista_insertar_ultimo(lista_t *lista, void *dato);
 
+// Agrega al final de la lista los cantidad elementos del arreglo datos, en
+// orden, copiandolos de a bloques.
+// Pre: la lista fue creada.
+// Post: devuelve false en caso de error, sin modificar la lista.
+bool lista_insertar_varios(lista_t *lista, void* const* datos, size_t cantidad);
+
+// Copia en el arreglo destino los elementos de la lista, en orden, hasta
+// llenar capacidad.
+// Pre: la lista fue creada.
+// Post: devuelve la cantidad de elementos copiados.
+size_t lista_exportar(const lista_t *lista, void** destino, size_t capacidad);
+
 // Obtiene el valor del primer elemento de la lista. Si la lista tiene
 // elementos, se devuelve el valor del primero, si está vacía devuelve NULL.
 // Pre: la lista fue creada.
@@ -71,6 +106,12 @@ size_t lista_largo(const lista_t *lista);
 // Post: se devolvió un iterador posicionado en el primer elemento
 lista_iter_t *lista_iter_crear(const lista_t *lista);
 
+// Posiciona en el primer elemento de la lista un iterador reservado por el
+// llamador (por ejemplo, una variable local). No se destruye con
+// lista_iter_destruir.
+// Pre: la lista fue creada.
+void lista_iter_iniciar(lista_iter_t *iter, const lista_t *lista);
+
 // Devuelve si el iterador se encuentra despues del ultimo elemento en la lista
 // Pre: el iterador fue creado
 // Post: se devolvio NULL si el iter no fue creado
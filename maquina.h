@@ -0,0 +1,51 @@
+#ifndef MAQUINA_H
+#define MAQUINA_H
+
+#include <stdbool.h>
+
+/* Maquina de votacion de una mesa. Implementada en tp1.c; este header la
+ * expone para los frentes que no leen de stdin (servidor). */
+typedef struct maquina_votacion maquina_votacion_t;
+
+/* Cuarto oscuro de una mesa. Cada uno lleva su propia sesion de votacion
+ * (votar inicio ... votar fin), asi que los comandos de varias cabinas de la
+ * misma mesa pueden intercalarse; la cola, el padron y los conteos son de la
+ * mesa. */
+typedef struct cabina cabina_t;
+
+/* Opciones de linea de comandos que se aplican a cada mesa */
+typedef struct opciones_maquina {
+    // Validar padron y voto al ingresar, en lugar de al iniciar la votacion
+    bool ingreso_estricto;
+    // Construir el padron en segundo plano, sin demorar la respuesta de abrir
+    bool carga_asincronica;
+    // Archivo donde publicar el filtro del padron al abrir (o NULL)
+    const char* archivo_filtro;
+    // Segmento de memoria compartida donde publicar los resultados (o NULL)
+    const char* segmento_resultados;
+    // Archivo donde llevar el registro de auditoria de las boletas (o NULL)
+    const char* archivo_auditoria;
+} opciones_maquina_t;
+
+// Crea una maquina de votacion con la mesa cerrada.
+// Post: devuelve NULL en caso de error.
+maquina_votacion_t* maquina_crear(const opciones_maquina_t* opciones);
+
+// Crea una cabina libre de la maquina.
+// Post: devuelve NULL en caso de error.
+cabina_t* cabina_crear(maquina_votacion_t* maquina);
+
+// Ejecuta una linea del protocolo de texto (sin el fin de linea) en la
+// cabina, escribiendo la respuesta en salida_actual().
+// Pre: la cabina fue creada.
+void ejecutar_comando(cabina_t* cabina, char* linea);
+
+// Destruye la cabina. Si habia un votante a mitad de su sesion, sus votos se
+// descartan (el padron ya lo tiene como votado).
+void cabina_destruir(cabina_t* cabina);
+
+// Destruye la maquina, esperando la carga del padron si estaba en curso.
+// Pre: sus cabinas ya fueron destruidas.
+void maquina_destruir(maquina_votacion_t* maquina);
+
+#endif // MAQUINA_H
@@ -0,0 +1,101 @@
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "nodos.h"
+
+// Bytes del primer bloque; cada bloque nuevo duplica al anterior hasta el
+// maximo, para que los contenedores chicos no reserven de mas. En un bloque
+// siempre entra al menos un nodo.
+#define BLOQUE_BYTES_INICIAL 512
+#define BLOQUE_BYTES_MAXIMO (64 * 1024)
+
+/* Encabezado de cada bloque; los nodos van a continuacion */
+typedef struct bloque {
+    struct bloque* siguiente;
+} bloque_t;
+
+/* Nodo devuelto: su primer palabra enlaza con el siguiente libre */
+typedef struct libre {
+    struct libre* siguiente;
+} libre_t;
+
+struct almacen_nodos {
+    size_t tamanio;
+    libre_t* libres;
+    // Parte sin usar del ultimo bloque
+    char* proximo;
+    char* fin;
+    bloque_t* bloques;
+    size_t bytes_por_bloque;
+};
+
+almacen_nodos_t* almacen_crear(size_t tamanio) {
+    almacen_nodos_t* almacen = malloc(sizeof(almacen_nodos_t));
+    if(!almacen) return NULL;
+
+    // Un nodo libre guarda un puntero, y todos quedan alineados como punteros.
+    if(tamanio < sizeof(libre_t)) tamanio = sizeof(libre_t);
+    almacen->tamanio = (tamanio + sizeof(void*) - 1) / sizeof(void*) * sizeof(void*);
+
+    almacen->libres = NULL;
+    almacen->proximo = NULL;
+    almacen->fin = NULL;
+    almacen->bloques = NULL;
+    almacen->bytes_por_bloque = BLOQUE_BYTES_INICIAL;
+    return almacen;
+}
+
+size_t almacen_tamanio(const almacen_nodos_t* almacen) {
+    return almacen->tamanio;
+}
+
+/* Agrega un bloque nuevo y lo deja como la parte sin usar */
+static bool agregar_bloque(almacen_nodos_t* almacen) {
+    size_t nodos = almacen->bytes_por_bloque / almacen->tamanio;
+    size_t bytes = (nodos ? nodos : 1) * almacen->tamanio;
+    bloque_t* bloque = malloc(sizeof(bloque_t) + bytes);
+    if(!bloque) return false;
+
+    bloque->siguiente = almacen->bloques;
+    almacen->bloques = bloque;
+    almacen->proximo = (char*) (bloque + 1);
+    almacen->fin = almacen->proximo + bytes;
+
+    if(almacen->bytes_por_bloque < BLOQUE_BYTES_MAXIMO)
+        almacen->bytes_por_bloque *= 2;
+    return true;
+}
+
+void* almacen_pedir(almacen_nodos_t* almacen) {
+    libre_t* libre = almacen->libres;
+    if(libre)
+    {
+        almacen->libres = libre->siguiente;
+        return libre;
+    }
+
+    if(almacen->proximo == almacen->fin && !agregar_bloque(almacen))
+        return NULL;
+
+    void* nodo = almacen->proximo;
+    almacen->proximo += almacen->tamanio;
+    return nodo;
+}
+
+void almacen_devolver(almacen_nodos_t* almacen, void* nodo) {
+    libre_t* libre = nodo;
+    libre->siguiente = almacen->libres;
+    almacen->libres = libre;
+}
+
+void almacen_destruir(almacen_nodos_t* almacen) {
+    if(!almacen) return;
+
+    while(almacen->bloques)
+    {
+        bloque_t* siguiente = almacen->bloques->siguiente;
+        free(almacen->bloques);
+        almacen->bloques = siguiente;
+    }
+    free(almacen);
+}
@@ -0,0 +1,47 @@
+#ifndef NODOS_H
+#define NODOS_H
+
+#include <stdlib.h>
+
+
+/* ******************************************************************
+ *                DEFINICION DE LOS TIPOS DE DATOS
+ * *****************************************************************/
+
+/* Almacen de nodos de un mismo tamanio. Los nodos se reparten de bloques
+ * grandes, uno detras de otro, y los devueltos quedan en una lista de libres:
+ * pedir un nodo es sacar un puntero de esa lista (o avanzar dentro del bloque
+ * actual), y los nodos de un mismo contenedor quedan cerca en memoria.
+ * La memoria vuelve al sistema recien al destruir el almacen.
+ *
+ * El almacen no usa locks: los contenedores que comparten uno no pueden
+ * usarse a la vez desde distintos hilos. */
+
+typedef struct almacen_nodos almacen_nodos_t;
+
+
+/* ******************************************************************
+ *                    PRIMITIVAS DEL ALMACEN
+ * *****************************************************************/
+
+// Crea un almacen de nodos de tamanio bytes, alineados como punteros.
+// Post: devuelve NULL en caso de error.
+almacen_nodos_t* almacen_crear(size_t tamanio);
+
+// Devuelve el tamanio de los nodos del almacen.
+// Pre: el almacen fue creado.
+size_t almacen_tamanio(const almacen_nodos_t* almacen);
+
+// Devuelve un nodo sin inicializar.
+// Pre: el almacen fue creado.
+// Post: devuelve NULL en caso de error.
+void* almacen_pedir(almacen_nodos_t* almacen);
+
+// Devuelve un nodo al almacen para reutilizarlo.
+// Pre: el nodo fue pedido a este almacen y no se volvio a devolver.
+void almacen_devolver(almacen_nodos_t* almacen, void* nodo);
+
+// Destruye el almacen y todos sus nodos, devueltos o no.
+void almacen_destruir(almacen_nodos_t* almacen);
+
+#endif // NODOS_H
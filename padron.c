@@ -0,0 +1,713 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "archivos.h"
+#include "bloom.h"
+#include "csv.h"
+#include "hash.h"
+#include "padron.h"
+#include "util.h"
+#include "votante_partido.h"
+
+/* Claves que entran en una linea de cache, para adelantar la lectura de los
+ nietos de un nodo en la busqueda de Eytzinger */
+#define CLAVES_POR_LINEA 8
+
+/* Claves por bloque en la disposicion comprimida: la primera va en el indice
+ y las demas como diferencias con la anterior */
+#define CLAVES_POR_BLOQUE 64
+
+/* Filas por seccion del indice ralo de la disposicion diferida: una busqueda
+ decodifica solo las secciones cuyo rango de numeros incluye al buscado */
+#define FILAS_POR_SECCION 1024
+
+/* Entradas por tramo en la disposicion diferida. Los tramos no se mueven al
+ crecer, asi el hash puede apuntar a sus entradas. */
+#define ENTRADAS_POR_TRAMO 4096
+
+/* Votante decodificado de un padron diferido. La clave va primero para que
+ el hash lo compare como a las claves sueltas. */
+typedef struct entrada_diferida {
+    uint64_t clave;
+    size_t posicion;
+} entrada_diferida_t;
+
+/* Seccion de FILAS_POR_SECCION filas de un padron diferido: donde empieza en
+ el archivo y el rango de numeros de documento de sus filas validas (vacio,
+ con minimo > maximo, si no tiene ninguna) */
+typedef struct seccion_diferida {
+    uint64_t inicio;
+    uint64_t minimo;
+    uint64_t maximo;
+} seccion_diferida_t;
+
+// Sufijo del indice de un padron diferido, guardado junto a su filtro
+#define INDICE_SUFIJO ".indice"
+
+static const char INDICE_MAGIA[8] = {'P','A','D','I','N','D','X','1'};
+
+/* Formato del indice guardado: la cabecera, los tipos de documento del
+ archivo (cada uno terminado en '\0') y las secciones */
+typedef struct cabecera_indice {
+    char magia[8];
+    uint64_t firma;
+    // Hasta donde hay filas: un registro que excede los limites del parser corta el archivo
+    uint64_t fin;
+    uint64_t cantidad_secciones;
+    uint64_t cantidad_tipos;
+    uint64_t largo_tipos;
+} cabecera_indice_t;
+
+struct padron {
+    padron_disposicion_t disposicion;
+    size_t cantidad;
+    // Hash: claves sin repetir en el orden del archivo.
+    // Eytzinger: claves[1..cantidad] en orden BFS; claves[0] no se usa.
+    uint64_t* claves;
+    // Hash: indice de punteros a claves (la posicion sale de restar claves)
+    hash_t* indice;
+    // Comprimido: primera clave de cada bloque, donde empiezan sus diferencias
+    // dentro de diferencias, y las diferencias en varint. No se guardan claves.
+    uint64_t* bloques_primera;
+    size_t* bloques_inicio;
+    uint8_t* diferencias;
+    size_t cantidad_bloques;
+    // Diferido: el archivo mapeado, sus secciones (y cuales ya se decodificaron)
+    // hasta fin, y las entradas decodificadas (indexadas en indice) en tramos
+    // de ENTRADAS_POR_TRAMO.
+    const char* mapa;
+    size_t largo_mapa;
+    seccion_diferida_t* secciones;
+    bool* decodificadas;
+    size_t cantidad_secciones;
+    size_t fin;
+    // Decodifica las filas con las mismas reglas que la carga completa
+    csv_t* csv;
+    entrada_diferida_t** tramos;
+    size_t cantidad_tramos;
+    // Un bit por posicion: si ese votante ya voto
+    uint64_t* votos;
+    size_t capacidad_votos;
+    // Descarta sin tocar el indice a los que no estan empadronados
+    bloom_t* filtro;
+};
+
+static const char* DISPOSICIONES[] = {"hash", "eytzinger", "comprimido", "diferido"};
+
+bool padron_disposicion_desde_nombre(const char* nombre, padron_disposicion_t* disposicion) {
+    for(size_t i=0;i<sizeof(DISPOSICIONES)/sizeof(DISPOSICIONES[0]);i++)
+        if(strcmp(nombre, DISPOSICIONES[i]) == 0) { *disposicion = (padron_disposicion_t) i; return true; }
+    return false;
+}
+
+static size_t hash_clave(const void* dato) {
+    return documento_hash(*(const uint64_t*) dato);
+}
+
+static bool iguales_clave(const void* a, const void* b) {
+    return *(const uint64_t*) a == *(const uint64_t*) b;
+}
+
+static int comparar_claves(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*) a, y = *(const uint64_t*) b;
+    return (x > y) - (x < y);
+}
+
+/* Indexa las claves en un hash, compactando el arreglo para sacar las repetidas */
+static bool indexar_hash(padron_t* padron) {
+    padron->indice = hash_crear(hash_clave, iguales_clave);
+    if(!padron->indice) return false;
+
+    size_t unicas = 0;
+    for(size_t i=0;i<padron->cantidad;i++)
+    {
+        if(hash_pertenece(padron->indice, &padron->claves[i])) continue;
+        padron->claves[unicas] = padron->claves[i];
+        if(!hash_guardar(padron->indice, &padron->claves[unicas])) return false;
+        unicas++;
+    }
+    padron->cantidad = unicas;
+    return true;
+}
+
+/* Copia las claves ordenadas al arreglo de Eytzinger, recorriendo el arbol en
+ inorden desde el nodo k. Devuelve la proxima clave ordenada a copiar. */
+static size_t llenar_eytzinger(const uint64_t* ordenadas, uint64_t* eytzinger, size_t i, size_t k, size_t cantidad) {
+    if(k > cantidad) return i;
+    i = llenar_eytzinger(ordenadas, eytzinger, i, 2*k, cantidad);
+    eytzinger[k] = ordenadas[i++];
+    return llenar_eytzinger(ordenadas, eytzinger, i, 2*k+1, cantidad);
+}
+
+/* Ordena las claves y saca las repetidas */
+static void ordenar_claves(padron_t* padron) {
+    qsort(padron->claves, padron->cantidad, sizeof(uint64_t), comparar_claves);
+
+    size_t unicas = 0;
+    for(size_t i=0;i<padron->cantidad;i++)
+        if(unicas == 0 || padron->claves[unicas-1] != padron->claves[i])
+            padron->claves[unicas++] = padron->claves[i];
+    padron->cantidad = unicas;
+}
+
+static bool indexar_eytzinger(padron_t* padron) {
+    ordenar_claves(padron);
+    size_t unicas = padron->cantidad;
+
+    uint64_t* eytzinger = malloc((unicas + 1) * sizeof(uint64_t));
+    if(!eytzinger) return false;
+
+    eytzinger[0] = 0;
+    llenar_eytzinger(padron->claves, eytzinger, 0, 1, unicas);
+
+    free(padron->claves);
+    padron->claves = eytzinger;
+    padron->cantidad = unicas;
+    return true;
+}
+
+/* Devuelve la posicion de la menor clave mayor o igual a la recibida, o 0 si no hay */
+static size_t eytzinger_cota_inferior(const padron_t* padron, uint64_t clave) {
+    const uint64_t* claves = padron->claves;
+    size_t k = 1;
+
+    while(k <= padron->cantidad)
+    {
+        __builtin_prefetch(claves + k * CLAVES_POR_LINEA);
+        k = 2*k + (claves[k] < clave);
+    }
+    // Se deshacen los ultimos pasos a la derecha y el ultimo a la izquierda.
+    k >>= __builtin_ffsll((long long) ~k);
+    return k;
+}
+
+static size_t largo_varint(uint64_t valor) {
+    size_t largo = 1;
+    while(valor >= 0x80) { valor >>= 7; largo++; }
+    return largo;
+}
+
+static uint8_t* escribir_varint(uint8_t* destino, uint64_t valor) {
+    while(valor >= 0x80)
+    {
+        *destino++ = (uint8_t) (valor | 0x80);
+        valor >>= 7;
+    }
+    *destino++ = (uint8_t) valor;
+    return destino;
+}
+
+static uint64_t leer_varint(const uint8_t** origen) {
+    const uint8_t* p = *origen;
+    uint64_t valor = 0;
+    unsigned desplazamiento = 0;
+
+    while(*p & 0x80)
+    {
+        valor |= (uint64_t) (*p++ & 0x7f) << desplazamiento;
+        desplazamiento += 7;
+    }
+    valor |= (uint64_t) *p++ << desplazamiento;
+    *origen = p;
+    return valor;
+}
+
+/* Codifica las claves ordenadas en bloques y libera el arreglo de claves */
+static bool indexar_comprimido(padron_t* padron) {
+    ordenar_claves(padron);
+
+    const uint64_t* claves = padron->claves;
+    size_t bloques = (padron->cantidad + CLAVES_POR_BLOQUE - 1) / CLAVES_POR_BLOQUE;
+
+    // Primera pasada para reservar lo justo: la idea es no pedir de mas.
+    size_t largo = 0;
+    for(size_t i=0;i<padron->cantidad;i++)
+        if(i % CLAVES_POR_BLOQUE) largo += largo_varint(claves[i] - claves[i-1]);
+
+    padron->bloques_primera = malloc((bloques + 1) * sizeof(uint64_t));
+    padron->bloques_inicio = malloc((bloques + 1) * sizeof(size_t));
+    padron->diferencias = malloc(largo + 1);
+    if(!padron->bloques_primera || !padron->bloques_inicio || !padron->diferencias) return false;
+
+    uint8_t* escritura = padron->diferencias;
+    for(size_t i=0;i<padron->cantidad;i++)
+    {
+        if(i % CLAVES_POR_BLOQUE == 0)
+        {
+            padron->bloques_primera[i / CLAVES_POR_BLOQUE] = claves[i];
+            padron->bloques_inicio[i / CLAVES_POR_BLOQUE] = (size_t) (escritura - padron->diferencias);
+        }
+        else
+            escritura = escribir_varint(escritura, claves[i] - claves[i-1]);
+    }
+
+    padron->cantidad_bloques = bloques;
+    free(padron->claves);
+    padron->claves = NULL;
+    return true;
+}
+
+/* Devuelve el ultimo bloque cuya primera clave es menor o igual a la recibida,
+ o cantidad_bloques si no hay ninguno */
+static size_t comprimido_bloque(const padron_t* padron, uint64_t clave) {
+    size_t inicio = 0, fin = padron->cantidad_bloques;
+    while(inicio < fin)
+    {
+        size_t medio = inicio + (fin - inicio) / 2;
+        if(padron->bloques_primera[medio] <= clave) inicio = medio + 1;
+        else fin = medio;
+    }
+    return inicio ? inicio - 1 : padron->cantidad_bloques;
+}
+
+/* Claves que tiene el bloque (el ultimo puede estar incompleto) */
+static size_t comprimido_largo_bloque(const padron_t* padron, size_t bloque) {
+    size_t resto = padron->cantidad - bloque * CLAVES_POR_BLOQUE;
+    return resto < CLAVES_POR_BLOQUE ? resto : CLAVES_POR_BLOQUE;
+}
+
+static size_t comprimido_buscar(const padron_t* padron, uint64_t clave) {
+    size_t bloque = comprimido_bloque(padron, clave);
+    if(bloque == padron->cantidad_bloques) return PADRON_AUSENTE;
+
+    uint64_t actual = padron->bloques_primera[bloque];
+    const uint8_t* lectura = padron->diferencias + padron->bloques_inicio[bloque];
+    size_t largo = comprimido_largo_bloque(padron, bloque);
+
+    for(size_t i=0;i<largo;i++)
+    {
+        if(i) actual += leer_varint(&lectura);
+        if(actual >= clave)
+            return actual == clave ? bloque * CLAVES_POR_BLOQUE + i : PADRON_AUSENTE;
+    }
+    return PADRON_AUSENTE;
+}
+
+/* Crea un padron vacio con la disposicion indicada */
+static padron_t* padron_nuevo(padron_disposicion_t disposicion) {
+    padron_t* padron = malloc(sizeof(padron_t));
+    if(!padron) return NULL;
+
+    padron->disposicion = disposicion;
+    padron->cantidad = 0;
+    padron->claves = NULL;
+    padron->indice = NULL;
+    padron->bloques_primera = NULL;
+    padron->bloques_inicio = NULL;
+    padron->diferencias = NULL;
+    padron->cantidad_bloques = 0;
+    padron->mapa = NULL;
+    padron->largo_mapa = 0;
+    padron->secciones = NULL;
+    padron->decodificadas = NULL;
+    padron->cantidad_secciones = 0;
+    padron->fin = 0;
+    padron->csv = NULL;
+    padron->tramos = NULL;
+    padron->cantidad_tramos = 0;
+    padron->votos = NULL;
+    padron->capacidad_votos = 0;
+    padron->filtro = NULL;
+    return padron;
+}
+
+padron_t* padron_crear(uint64_t* claves, size_t cantidad, padron_disposicion_t disposicion) {
+    padron_t* padron = disposicion != PADRON_DIFERIDO ? padron_nuevo(disposicion) : NULL;
+    if(!padron) { free(claves); return NULL; }
+
+    padron->cantidad = cantidad;
+    padron->claves = claves;
+
+    // El filtro ocuparia mas que las claves comprimidas: ahi no se usa.
+    if(disposicion != PADRON_COMPRIMIDO)
+        padron->filtro = bloom_crear(cantidad);
+
+    bool indexado;
+    if(disposicion == PADRON_EYTZINGER)
+        indexado = indexar_eytzinger(padron);
+    else if(disposicion == PADRON_COMPRIMIDO)
+        indexado = indexar_comprimido(padron);
+    else
+        indexado = indexar_hash(padron);
+
+    // Las posiciones de Eytzinger arrancan en 1.
+    if(indexado) padron->votos = calloc(padron->cantidad / 64 + 1, sizeof(uint64_t));
+
+    if(!indexado || !padron->votos || (!padron->filtro && disposicion != PADRON_COMPRIMIDO))
+    {
+        padron_destruir(padron);
+        return NULL;
+    }
+
+    // El filtro se comparte con otros procesos (ver padron_guardar_filtro), que
+    // pueden haber dado otros ids a los tipos: va la huella, no la clave.
+    if(padron->filtro)
+        for(size_t i=0;i<padron->cantidad;i++)
+            bloom_agregar(padron->filtro, documento_huella(padron->claves[i + (disposicion == PADRON_EYTZINGER)]));
+
+    return padron;
+}
+
+static bool saltear_encabezado(const campo_csv_t* campos, size_t cantidad, void* extra) {
+    return true;
+}
+
+/* Fila decodificada de un padron diferido */
+typedef struct fila_diferida {
+    bool valida;
+    uint64_t clave;
+} fila_diferida_t;
+
+/* Visitar de csv_siguiente_registro: la clave de la fila tipo,numero. Como en
+ la carga completa, las filas con documento invalido no valen. */
+static bool diferido_fila(const campo_csv_t* campos, size_t cantidad, void* extra) {
+    fila_diferida_t* fila = extra;
+    uint64_t doc_num;
+    fila->valida = cantidad >= 2 && documento_numero_parsear(campos[1].dato, &doc_num) &&
+                   documento_clave_internar(campos[0].dato, doc_num, &fila->clave);
+    return true;
+}
+
+/* Tipos de documento que aparecen en un padron diferido, por una clave de ejemplo */
+typedef struct tipos_diferidos {
+    uint64_t* ejemplos;
+    size_t cantidad;
+} tipos_diferidos_t;
+
+/* Lo que no es el numero de la clave identifica a su tipo */
+static uint64_t tipo_de_clave(uint64_t clave) {
+    return clave ^ documento_clave_numero(clave);
+}
+
+/* Anota el tipo de la clave si es la primera fila con ese tipo */
+static bool anotar_tipo(tipos_diferidos_t* tipos, uint64_t clave) {
+    for(size_t i=0;i<tipos->cantidad;i++)
+        if(tipo_de_clave(tipos->ejemplos[i]) == tipo_de_clave(clave)) return true;
+
+    uint64_t* ejemplos = realloc(tipos->ejemplos, (tipos->cantidad + 1) * sizeof(uint64_t));
+    if(!ejemplos) return false;
+    tipos->ejemplos = ejemplos;
+    tipos->ejemplos[tipos->cantidad++] = clave;
+    return true;
+}
+
+/* Agrega una seccion sin filas que empieza en inicio */
+static bool agregar_seccion(padron_t* padron, size_t inicio) {
+    seccion_diferida_t* secciones = realloc(padron->secciones, (padron->cantidad_secciones + 1) * sizeof(seccion_diferida_t));
+    if(!secciones) return false;
+    padron->secciones = secciones;
+    secciones[padron->cantidad_secciones++] = (seccion_diferida_t) { inicio, UINT64_MAX, 0 };
+    return true;
+}
+
+/* Recorre las filas desde inicio sin indexarlas, para armar las secciones e
+ internar los tipos de documento, que anota en tipos. Usa su propio parser:
+ un registro que excede sus limites lo deja fallado. */
+static bool diferido_recorrer(padron_t* padron, size_t inicio, tipos_diferidos_t* tipos) {
+    csv_t* csv = csv_crear(',');
+    if(!csv) return false;
+
+    size_t leido = inicio, filas = 0;
+    bool recorrido = true;
+    while(recorrido && leido < padron->largo_mapa)
+    {
+        if(filas++ % FILAS_POR_SECCION == 0 && !(recorrido = agregar_seccion(padron, leido))) break;
+
+        fila_diferida_t fila = { false, 0 };
+        size_t consumido = csv_siguiente_registro(csv, padron->mapa + leido, padron->largo_mapa - leido, diferido_fila, &fila);
+        if(csv_fallo(csv)) break;
+        leido += consumido;
+        if(!fila.valida) continue;
+
+        uint64_t numero = documento_clave_numero(fila.clave);
+        seccion_diferida_t* seccion = &padron->secciones[padron->cantidad_secciones - 1];
+        if(numero < seccion->minimo) seccion->minimo = numero;
+        if(numero > seccion->maximo) seccion->maximo = numero;
+
+        // Las filas de un mismo tipo suelen venir juntas.
+        if(!tipos->cantidad || tipo_de_clave(tipos->ejemplos[tipos->cantidad - 1]) != tipo_de_clave(fila.clave))
+            recorrido = anotar_tipo(tipos, fila.clave);
+    }
+    padron->fin = leido;
+    csv_cerrar(csv);
+    return recorrido;
+}
+
+/* Indice a guardar, con los tipos del padron */
+typedef struct indice_guardado {
+    const padron_t* padron;
+    const tipos_diferidos_t* tipos;
+    uint64_t firma;
+} indice_guardado_t;
+
+static bool escribir_indice(FILE* archivo, const void* dato) {
+    const indice_guardado_t* guardado = dato;
+    const padron_t* padron = guardado->padron;
+    const tipos_diferidos_t* tipos = guardado->tipos;
+
+    cabecera_indice_t cabecera;
+    memset(&cabecera, 0, sizeof(cabecera_indice_t));
+    memcpy(cabecera.magia, INDICE_MAGIA, sizeof(INDICE_MAGIA));
+    cabecera.firma = guardado->firma;
+    cabecera.fin = padron->fin;
+    cabecera.cantidad_secciones = padron->cantidad_secciones;
+    cabecera.cantidad_tipos = tipos->cantidad;
+    for(size_t i=0;i<tipos->cantidad;i++)
+        cabecera.largo_tipos += strlen(documento_clave_tipo(tipos->ejemplos[i])) + 1;
+
+    bool escrito = fwrite(&cabecera, sizeof(cabecera_indice_t), 1, archivo) == 1;
+    for(size_t i=0;i<tipos->cantidad && escrito;i++)
+    {
+        const char* tipo = documento_clave_tipo(tipos->ejemplos[i]);
+        escrito = fwrite(tipo, 1, strlen(tipo) + 1, archivo) == strlen(tipo) + 1;
+    }
+    return escrito && fwrite(padron->secciones, sizeof(seccion_diferida_t), padron->cantidad_secciones, archivo) == padron->cantidad_secciones;
+}
+
+/* Lee el indice guardado para esta version del archivo, interna sus tipos y
+ toma sus secciones.
+ Post: devuelve false, sin tomar nada, si no hay uno valido. */
+static bool diferido_cargar_indice(padron_t* padron, const char* nombre, uint64_t firma) {
+    FILE* archivo = fopen(nombre, "rb");
+    if(!archivo) return false;
+
+    cabecera_indice_t cabecera;
+    bool valido = fread(&cabecera, sizeof(cabecera_indice_t), 1, archivo) == 1 &&
+                  memcmp(cabecera.magia, INDICE_MAGIA, sizeof(INDICE_MAGIA)) == 0 && cabecera.firma == firma &&
+                  cabecera.fin <= padron->largo_mapa && cabecera.cantidad_secciones <= padron->largo_mapa &&
+                  cabecera.largo_tipos <= (uint64_t) CSV_REGISTRO_MAXIMO * cabecera.cantidad_tipos;
+
+    char* tipos = valido ? malloc((size_t) cabecera.largo_tipos + 1) : NULL;
+    seccion_diferida_t* secciones = valido ? malloc(((size_t) cabecera.cantidad_secciones + 1) * sizeof(seccion_diferida_t)) : NULL;
+    valido = tipos && secciones && fread(tipos, 1, (size_t) cabecera.largo_tipos, archivo) == cabecera.largo_tipos &&
+             fread(secciones, sizeof(seccion_diferida_t), (size_t) cabecera.cantidad_secciones, archivo) == cabecera.cantidad_secciones &&
+             fgetc(archivo) == EOF;
+    fclose(archivo);
+
+    // Cada tipo termina en '\0', y las secciones van en orden antes del fin.
+    size_t terminados = 0;
+    for(size_t i=0;valido && i<cabecera.largo_tipos;i++)
+        terminados += tipos[i] == '\0';
+    valido = valido && terminados == cabecera.cantidad_tipos && (!cabecera.largo_tipos || tipos[cabecera.largo_tipos - 1] == '\0');
+    for(size_t i=0;valido && i<cabecera.cantidad_secciones;i++)
+        valido = secciones[i].inicio <= cabecera.fin && (!i || secciones[i-1].inicio < secciones[i].inicio);
+
+    uint64_t clave;
+    for(const char* tipo=tipos;valido && tipo<tipos+cabecera.largo_tipos;tipo+=strlen(tipo)+1)
+        valido = documento_clave_internar(tipo, 0, &clave);
+
+    free(tipos);
+    if(!valido) { free(secciones); return false; }
+
+    padron->secciones = secciones;
+    padron->cantidad_secciones = (size_t) cabecera.cantidad_secciones;
+    padron->fin = (size_t) cabecera.fin;
+    return true;
+}
+
+/*
+ Arma las secciones del padron diferido a partir de inicio, e interna sus
+ tipos. Con archivo_filtro las toma del indice guardado junto a el, si es de
+ esta version del archivo, y si no lo guarda para la proxima vez.
+*/
+static bool diferido_indexar(padron_t* padron, size_t inicio, const char* archivo_filtro, uint64_t firma) {
+    char* nombre = NULL;
+    if(archivo_filtro && firma && (nombre = malloc(strlen(archivo_filtro) + sizeof(INDICE_SUFIJO))))
+    {
+        sprintf(nombre, "%s%s", archivo_filtro, INDICE_SUFIJO);
+        if(diferido_cargar_indice(padron, nombre, firma)) { free(nombre); return true; }
+    }
+
+    tipos_diferidos_t tipos = { NULL, 0 };
+    bool indexado = diferido_recorrer(padron, inicio, &tipos);
+
+    // Si no se puede guardar, la proxima vez se vuelve a recorrer.
+    indice_guardado_t guardado = { padron, &tipos, firma };
+    if(indexado && nombre) archivo_reemplazar(nombre, escribir_indice, &guardado);
+
+    free(tipos.ejemplos);
+    free(nombre);
+    return indexado;
+}
+
+padron_t* padron_abrir_diferido(const char* nombre, const char* archivo_filtro) {
+    int fd = open(nombre, O_RDONLY);
+    if(fd < 0) return NULL;
+
+    struct stat datos;
+    padron_t* padron = fstat(fd, &datos) == 0 ? padron_nuevo(PADRON_DIFERIDO) : NULL;
+    if(padron) padron->indice = hash_crear(hash_clave, iguales_clave);
+    if(padron) padron->csv = csv_crear(',');
+
+    if(padron && padron->indice && padron->csv && datos.st_size > 0)
+    {
+        void* mapa = mmap(NULL, (size_t) datos.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(mapa != MAP_FAILED)
+        {
+            padron->mapa = mapa;
+            padron->largo_mapa = (size_t) datos.st_size;
+            posix_madvise(mapa, padron->largo_mapa, POSIX_MADV_SEQUENTIAL);
+        }
+    }
+    close(fd);
+
+    if(!padron || !padron->indice || !padron->csv || (datos.st_size > 0 && !padron->mapa))
+    {
+        padron_destruir(padron);
+        return NULL;
+    }
+
+    size_t inicio = 0;
+    if(padron->mapa)
+        inicio = csv_siguiente_registro(padron->csv, padron->mapa, padron->largo_mapa, saltear_encabezado, NULL);
+
+    // Los tipos se conocen desde ahora: uno desconocido al ingresar no esta en
+    // el padron, sin decodificar el resto del archivo para saberlo.
+    uint64_t firma = archivo_filtro ? firma_archivo(nombre) : 0;
+    if(!diferido_indexar(padron, inicio, archivo_filtro, firma) ||
+       !(padron->decodificadas = calloc(padron->cantidad_secciones + 1, sizeof(bool))))
+    {
+        padron_destruir(padron);
+        return NULL;
+    }
+
+    if(firma)
+        padron->filtro = bloom_cargar(archivo_filtro, firma);
+
+    return padron;
+}
+
+/* Agrega una entrada decodificada con la proxima posicion */
+static bool diferido_agregar(padron_t* padron, uint64_t clave) {
+    size_t posicion = padron->cantidad;
+
+    if(posicion == padron->cantidad_tramos * ENTRADAS_POR_TRAMO)
+    {
+        entrada_diferida_t** tramos = realloc(padron->tramos, (padron->cantidad_tramos + 1) * sizeof(entrada_diferida_t*));
+        if(!tramos) return false;
+        padron->tramos = tramos;
+        tramos[padron->cantidad_tramos] = malloc(ENTRADAS_POR_TRAMO * sizeof(entrada_diferida_t));
+        if(!tramos[padron->cantidad_tramos]) return false;
+        padron->cantidad_tramos++;
+    }
+
+    if(posicion / 64 == padron->capacidad_votos)
+    {
+        size_t capacidad = padron->capacidad_votos ? padron->capacidad_votos * 2 : 64;
+        uint64_t* votos = realloc(padron->votos, capacidad * sizeof(uint64_t));
+        if(!votos) return false;
+        memset(votos + padron->capacidad_votos, 0, (capacidad - padron->capacidad_votos) * sizeof(uint64_t));
+        padron->votos = votos;
+        padron->capacidad_votos = capacidad;
+    }
+
+    entrada_diferida_t* entrada = &padron->tramos[posicion / ENTRADAS_POR_TRAMO][posicion % ENTRADAS_POR_TRAMO];
+    entrada->clave = clave;
+    entrada->posicion = posicion;
+
+    if(!hash_guardar(padron->indice, entrada)) return false;
+    padron->cantidad++;
+    return true;
+}
+
+/* Decodifica las filas de la seccion. Las filas invalidas se saltean, como al
+ cargar el padron completo, y ante documentos repetidos vale el primero que
+ se decodifico. */
+static bool diferido_decodificar(padron_t* padron, size_t seccion) {
+    size_t leido = (size_t) padron->secciones[seccion].inicio;
+    size_t fin = seccion + 1 < padron->cantidad_secciones ? (size_t) padron->secciones[seccion + 1].inicio : padron->fin;
+    padron->decodificadas[seccion] = true;
+
+    while(leido < fin && !csv_fallo(padron->csv))
+    {
+        fila_diferida_t fila = { false, 0 };
+        leido += csv_siguiente_registro(padron->csv, padron->mapa + leido, fin - leido, diferido_fila, &fila);
+        if(!fila.valida || hash_pertenece(padron->indice, &fila.clave)) continue;
+        if(!diferido_agregar(padron, fila.clave)) return false;
+    }
+    return true;
+}
+
+/* Decodifica las secciones que pueden tener la clave buscada hasta encontrarla */
+static size_t diferido_buscar(padron_t* padron, uint64_t buscada) {
+    uint64_t numero = documento_clave_numero(buscada);
+
+    for(size_t i=0;i<padron->cantidad_secciones;i++)
+    {
+        const seccion_diferida_t* seccion = &padron->secciones[i];
+        if(padron->decodificadas[i] || numero < seccion->minimo || numero > seccion->maximo) continue;
+        if(!diferido_decodificar(padron, i)) return PADRON_AUSENTE;
+
+        const entrada_diferida_t* entrada = hash_obtener(padron->indice, &buscada);
+        if(entrada) return entrada->posicion;
+    }
+    return PADRON_AUSENTE;
+}
+
+size_t padron_buscar(padron_t* padron, uint64_t clave) {
+    // En el diferido lo ya decodificado sale del archivo mismo: el filtro, que
+    // viene de otro proceso, solo evita decodificar el resto.
+    if(padron->disposicion == PADRON_DIFERIDO)
+    {
+        const entrada_diferida_t* entrada = hash_obtener(padron->indice, &clave);
+        if(entrada) return entrada->posicion;
+        if(padron->filtro && !bloom_puede_contener(padron->filtro, documento_huella(clave)))
+            return PADRON_AUSENTE;
+        return diferido_buscar(padron, clave);
+    }
+
+    if(padron->filtro && !bloom_puede_contener(padron->filtro, documento_huella(clave)))
+        return PADRON_AUSENTE;
+
+    if(padron->disposicion == PADRON_COMPRIMIDO)
+        return comprimido_buscar(padron, clave);
+
+    if(padron->disposicion == PADRON_EYTZINGER)
+    {
+        size_t k = eytzinger_cota_inferior(padron, clave);
+        return (k && padron->claves[k] == clave) ? k : PADRON_AUSENTE;
+    }
+
+    const uint64_t* encontrada = hash_obtener(padron->indice, &clave);
+    return encontrada ? (size_t) (encontrada - padron->claves) : PADRON_AUSENTE;
+}
+
+bool padron_voto_realizado(const padron_t* padron, size_t posicion) {
+    return (padron->votos[posicion / 64] >> (posicion % 64)) & 1;
+}
+
+void padron_registrar_voto(padron_t* padron, size_t posicion) {
+    padron->votos[posicion / 64] |= (uint64_t) 1 << (posicion % 64);
+}
+
+bool padron_guardar_filtro(const padron_t* padron, const char* nombre, uint64_t firma) {
+    // Sin firma no se sabria cuando el filtro queda viejo.
+    return padron->filtro && firma && bloom_guardar(padron->filtro, nombre, firma);
+}
+
+void padron_destruir(padron_t* padron) {
+    if(!padron) return;
+    if(padron->indice) hash_destruir(padron->indice, NULL);
+    if(padron->filtro) bloom_destruir(padron->filtro);
+    free(padron->bloques_primera);
+    free(padron->bloques_inicio);
+    free(padron->diferencias);
+    if(padron->mapa) munmap((void*) padron->mapa, padron->largo_mapa);
+    free(padron->secciones);
+    free(padron->decodificadas);
+    csv_cerrar(padron->csv);
+    for(size_t i=0;i<padron->cantidad_tramos;i++)
+        free(padron->tramos[i]);
+    free(padron->tramos);
+    free(padron->votos);
+    free(padron->claves);
+    free(padron);
+}
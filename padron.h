@@ -0,0 +1,72 @@
+#ifndef PADRON_H
+#define PADRON_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/* Padron de la mesa: las claves de documento (ver documento_clave) de los
+ * votantes habilitados, indexadas para validarlas sin recorrer todo el archivo,
+ * junto con el registro de quienes ya votaron. */
+typedef struct padron padron_t;
+
+/* Disposiciones en memoria del indice del padron */
+typedef enum {
+    // Hash cerrado sobre el arreglo de claves
+    PADRON_HASH,
+    // Arreglo ordenado en orden de Eytzinger (BFS), con busqueda sin saltos
+    PADRON_EYTZINGER,
+    // Claves ordenadas en bloques de diferencias codificadas como varint, con
+    // un indice de la primera clave de cada bloque. Para equipos con poca memoria.
+    PADRON_COMPRIMIDO,
+    // Archivo mapeado en memoria que se decodifica a medida que se busca,
+    // sobre un hash como el de PADRON_HASH. Se crea con padron_abrir_diferido.
+    PADRON_DIFERIDO
+} padron_disposicion_t;
+
+/* Posicion devuelta por padron_buscar para los no empadronados */
+#define PADRON_AUSENTE ((size_t) -1)
+
+/* Obtiene la disposicion por su nombre ("hash", "eytzinger", "comprimido", "diferido").
+ Post: devuelve false si el nombre no corresponde a ninguna. */
+bool padron_disposicion_desde_nombre(const char* nombre, padron_disposicion_t* disposicion);
+
+/* Crea el padron a partir de un arreglo de claves, del que toma posesion
+ (aun si falla). Las claves repetidas se cuentan una sola vez.
+ Post: devuelve NULL en caso de error. */
+padron_t* padron_crear(uint64_t* claves, size_t cantidad, padron_disposicion_t disposicion);
+
+/* Crea un padron diferido sobre el archivo csv de padron: lo mapea en memoria
+ y decodifica sus filas recien cuando una busqueda las necesita. Al abrirlo
+ lo recorre para internar sus tipos de documento y anotar, cada tantas filas,
+ donde empieza la seccion y el rango de numeros que tiene: una busqueda solo
+ decodifica las secciones cuyo rango incluye al numero buscado.
+ Si archivo_filtro no es NULL, ese recorrido se guarda en
+ "<archivo_filtro>.indice" y, mientras el archivo no cambie, se lee de ahi en
+ vez de recorrerlo. Si ademas tiene un filtro guardado para este mismo archivo
+ (ver padron_guardar_filtro), se usa para descartar a los no empadronados sin
+ decodificar nada.
+ Post: devuelve NULL si no se pudo abrir el archivo o en caso de error. */
+padron_t* padron_abrir_diferido(const char* nombre, const char* archivo_filtro);
+
+/* Devuelve la posicion del votante con esa clave en el padron, o PADRON_AUSENTE
+ si no esta empadronado. La posicion solo sirve para las primitivas de voto.
+ En un padron diferido puede decodificar parte del archivo. */
+size_t padron_buscar(padron_t* padron, uint64_t clave);
+
+/* Devuelve si el votante en esa posicion ya voto */
+bool padron_voto_realizado(const padron_t* padron, size_t posicion);
+
+/* Registra que el votante en esa posicion voto */
+void padron_registrar_voto(padron_t* padron, size_t posicion);
+
+/* Guarda el filtro de pertenencia del padron en un archivo, para que otros
+ procesos lo compartan. La firma identifica el archivo de padron de origen.
+ Post: devuelve false en caso de error, si la firma es 0 (no se pudo obtener)
+ o si el padron es comprimido (no lleva filtro, que ocuparia mas que las claves). */
+bool padron_guardar_filtro(const padron_t* padron, const char* nombre, uint64_t firma);
+
+/* Destruye el padron */
+void padron_destruir(padron_t* padron);
+
+#endif
@@ -0,0 +1,314 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "planificador.h"
+#include "cola.h"
+
+#define DEQUE_CAPACIDAD_INICIAL 16
+// Tareas que se ejecutan de un trabajo antes de devolverlo a su deque, para
+// que un trabajo muy cargado no acapare al hilo.
+#define LOTE_MAXIMO 64
+
+struct trabajo {
+    pthread_mutex_t mutex;
+    cola_t* tareas;
+    // Esta en una deque o ejecutandose: no se vuelve a encolar
+    bool programado;
+    // No recibe mas tareas: se destruye al vaciarse
+    bool cerrado;
+    void (*destruir)(void*);
+    void* dato;
+    size_t hogar;
+};
+
+/* Deque circular de trabajos. El hilo duenio saca del final (lo ultimo que
+ * se encolo, que tiene los datos mas frescos en cache) y los ladrones del
+ * principio (lo que mas espero). */
+typedef struct deque {
+    pthread_mutex_t mutex;
+    trabajo_t** datos;
+    size_t capacidad;
+    size_t inicio;
+    size_t cantidad;
+} deque_t;
+
+typedef struct hilo {
+    planificador_t* planificador;
+    size_t indice;
+    pthread_t id;
+} hilo_t;
+
+struct planificador {
+    size_t cantidad_hilos;
+    hilo_t* hilos;
+    deque_t* deques;
+    ejecutar_tarea_t ejecutar;
+    void* extra;
+    // Protege programados, terminar y proximo_hogar
+    pthread_mutex_t mutex;
+    pthread_cond_t hay_trabajo;
+    // Trabajos en las deques que ningun hilo reservo todavia
+    size_t programados;
+    bool terminar;
+    size_t proximo_hogar;
+};
+
+static bool deque_agregar(deque_t* deque, trabajo_t* trabajo) {
+    if(deque->cantidad == deque->capacidad)
+    {
+        size_t capacidad = deque->capacidad * 2;
+        trabajo_t** datos = malloc(capacidad * sizeof(trabajo_t*));
+        if(!datos) return false;
+        for(size_t i=0;i<deque->cantidad;i++)
+            datos[i] = deque->datos[(deque->inicio + i) % deque->capacidad];
+        free(deque->datos);
+        deque->datos = datos;
+        deque->capacidad = capacidad;
+        deque->inicio = 0;
+    }
+    deque->datos[(deque->inicio + deque->cantidad) % deque->capacidad] = trabajo;
+    deque->cantidad++;
+    return true;
+}
+
+static trabajo_t* deque_sacar_ultimo(deque_t* deque) {
+    if(!deque->cantidad) return NULL;
+    deque->cantidad--;
+    return deque->datos[(deque->inicio + deque->cantidad) % deque->capacidad];
+}
+
+static trabajo_t* deque_sacar_primero(deque_t* deque) {
+    if(!deque->cantidad) return NULL;
+    trabajo_t* trabajo = deque->datos[deque->inicio];
+    deque->inicio = (deque->inicio + 1) % deque->capacidad;
+    deque->cantidad--;
+    return trabajo;
+}
+
+/* Pone el trabajo en la deque de su hogar y despierta a un hilo */
+static bool programar(planificador_t* planificador, trabajo_t* trabajo) {
+    deque_t* deque = &planificador->deques[trabajo->hogar];
+    pthread_mutex_lock(&deque->mutex);
+    bool agregado = deque_agregar(deque, trabajo);
+    pthread_mutex_unlock(&deque->mutex);
+    if(!agregado) return false;
+
+    pthread_mutex_lock(&planificador->mutex);
+    planificador->programados++;
+    pthread_cond_signal(&planificador->hay_trabajo);
+    pthread_mutex_unlock(&planificador->mutex);
+    return true;
+}
+
+/* Espera a que haya un trabajo y lo saca de la deque propia o, si esta
+ * vacia, de la de otro hilo. Devuelve NULL cuando hay que terminar. */
+static trabajo_t* tomar_trabajo(planificador_t* planificador, size_t indice) {
+    pthread_mutex_lock(&planificador->mutex);
+    while(!planificador->programados && !planificador->terminar)
+        pthread_cond_wait(&planificador->hay_trabajo, &planificador->mutex);
+    if(!planificador->programados)
+    {
+        pthread_mutex_unlock(&planificador->mutex);
+        return NULL;
+    }
+    // Reservar uno: alguna deque tiene un trabajo para este hilo.
+    planificador->programados--;
+    pthread_mutex_unlock(&planificador->mutex);
+
+    for(size_t vuelta=0;;vuelta++)
+    {
+        size_t victima = (indice + vuelta) % planificador->cantidad_hilos;
+        deque_t* deque = &planificador->deques[victima];
+
+        pthread_mutex_lock(&deque->mutex);
+        trabajo_t* trabajo = victima == indice ? deque_sacar_ultimo(deque) : deque_sacar_primero(deque);
+        pthread_mutex_unlock(&deque->mutex);
+        if(trabajo) return trabajo;
+    }
+}
+
+static void destruir_trabajo_cerrado(trabajo_t* trabajo) {
+    void (*destruir)(void*) = trabajo->destruir;
+    void* dato = trabajo->dato;
+    trabajo_destruir(trabajo);
+    if(destruir) destruir(dato);
+}
+
+/* Ejecuta tareas del trabajo en orden hasta vaciarlo o completar un lote */
+static void ejecutar_lote(planificador_t* planificador, trabajo_t* trabajo) {
+    for(size_t ejecutadas=0;;ejecutadas++)
+    {
+        pthread_mutex_lock(&trabajo->mutex);
+        if(cola_esta_vacia(trabajo->tareas))
+        {
+            trabajo->programado = false;
+            bool cerrado = trabajo->cerrado;
+            pthread_mutex_unlock(&trabajo->mutex);
+            if(cerrado) destruir_trabajo_cerrado(trabajo);
+            return;
+        }
+        if(ejecutadas == LOTE_MAXIMO)
+        {
+            pthread_mutex_unlock(&trabajo->mutex);
+            // Sigue programado: vuelve al final de su deque.
+            if(programar(planificador, trabajo)) return;
+            pthread_mutex_lock(&trabajo->mutex);
+        }
+        void* tarea = cola_desencolar(trabajo->tareas);
+        pthread_mutex_unlock(&trabajo->mutex);
+
+        planificador->ejecutar(tarea, planificador->extra);
+    }
+}
+
+static void* hilo_trabajador(void* dato) {
+    hilo_t* hilo = dato;
+    trabajo_t* trabajo;
+    while((trabajo = tomar_trabajo(hilo->planificador, hilo->indice)))
+        ejecutar_lote(hilo->planificador, trabajo);
+    return NULL;
+}
+
+planificador_t* planificador_crear(size_t hilos, ejecutar_tarea_t ejecutar, void* extra) {
+    if(!hilos || !ejecutar) return NULL;
+
+    planificador_t* planificador = malloc(sizeof(planificador_t));
+    if(!planificador) return NULL;
+
+    planificador->hilos = malloc(hilos * sizeof(hilo_t));
+    planificador->deques = malloc(hilos * sizeof(deque_t));
+    if(!planificador->hilos || !planificador->deques)
+    {
+        free(planificador->hilos);
+        free(planificador->deques);
+        free(planificador);
+        return NULL;
+    }
+
+    planificador->ejecutar = ejecutar;
+    planificador->extra = extra;
+    planificador->programados = 0;
+    planificador->terminar = false;
+    planificador->proximo_hogar = 0;
+    pthread_mutex_init(&planificador->mutex, NULL);
+    pthread_cond_init(&planificador->hay_trabajo, NULL);
+
+    size_t creados = 0;
+    for(;creados<hilos;creados++)
+    {
+        deque_t* deque = &planificador->deques[creados];
+        deque->datos = malloc(DEQUE_CAPACIDAD_INICIAL * sizeof(trabajo_t*));
+        if(!deque->datos) break;
+        deque->capacidad = DEQUE_CAPACIDAD_INICIAL;
+        deque->inicio = 0;
+        deque->cantidad = 0;
+        pthread_mutex_init(&deque->mutex, NULL);
+
+        hilo_t* hilo = &planificador->hilos[creados];
+        hilo->planificador = planificador;
+        hilo->indice = creados;
+        if(pthread_create(&hilo->id, NULL, hilo_trabajador, hilo) != 0)
+        {
+            pthread_mutex_destroy(&deque->mutex);
+            free(deque->datos);
+            break;
+        }
+    }
+    planificador->cantidad_hilos = creados;
+
+    if(creados < hilos)
+    {
+        planificador_destruir(planificador);
+        return NULL;
+    }
+    return planificador;
+}
+
+trabajo_t* trabajo_crear(planificador_t* planificador) {
+    trabajo_t* trabajo = malloc(sizeof(trabajo_t));
+    if(!trabajo) return NULL;
+
+    trabajo->tareas = cola_crear();
+    if(!trabajo->tareas) { free(trabajo); return NULL; }
+
+    pthread_mutex_init(&trabajo->mutex, NULL);
+    trabajo->programado = false;
+    trabajo->cerrado = false;
+    trabajo->destruir = NULL;
+    trabajo->dato = NULL;
+
+    // Los hogares se reparten en orden entre los hilos.
+    pthread_mutex_lock(&planificador->mutex);
+    trabajo->hogar = planificador->proximo_hogar++ % planificador->cantidad_hilos;
+    pthread_mutex_unlock(&planificador->mutex);
+    return trabajo;
+}
+
+bool planificador_encolar(planificador_t* planificador, trabajo_t* trabajo, void* tarea) {
+    pthread_mutex_lock(&trabajo->mutex);
+    if(trabajo->cerrado || !cola_encolar(trabajo->tareas, tarea))
+    {
+        pthread_mutex_unlock(&trabajo->mutex);
+        return false;
+    }
+    bool inactivo = !trabajo->programado;
+    trabajo->programado = true;
+    pthread_mutex_unlock(&trabajo->mutex);
+
+    // Si ya estaba programado, el hilo que lo tenga va a ver la tarea nueva.
+    if(inactivo && !programar(planificador, trabajo))
+    {
+        // Sin lugar en la deque: se deshace el encolado de esta tarea, que
+        // es la unica porque el trabajo estaba inactivo.
+        pthread_mutex_lock(&trabajo->mutex);
+        cola_desencolar(trabajo->tareas);
+        trabajo->programado = false;
+        pthread_mutex_unlock(&trabajo->mutex);
+        return false;
+    }
+    return true;
+}
+
+void trabajo_cerrar(trabajo_t* trabajo, void destruir(void*), void* dato) {
+    pthread_mutex_lock(&trabajo->mutex);
+    trabajo->cerrado = true;
+    trabajo->destruir = destruir;
+    trabajo->dato = dato;
+    // Inactivo implica vacio: nadie mas lo va a tocar.
+    bool inactivo = !trabajo->programado;
+    pthread_mutex_unlock(&trabajo->mutex);
+
+    if(inactivo) destruir_trabajo_cerrado(trabajo);
+}
+
+void trabajo_destruir(trabajo_t* trabajo) {
+    if(!trabajo) return;
+    cola_destruir(trabajo->tareas, NULL);
+    pthread_mutex_destroy(&trabajo->mutex);
+    free(trabajo);
+}
+
+void planificador_destruir(planificador_t* planificador) {
+    if(!planificador) return;
+
+    pthread_mutex_lock(&planificador->mutex);
+    planificador->terminar = true;
+    pthread_cond_broadcast(&planificador->hay_trabajo);
+    pthread_mutex_unlock(&planificador->mutex);
+
+    for(size_t i=0;i<planificador->cantidad_hilos;i++)
+    {
+        pthread_join(planificador->hilos[i].id, NULL);
+        pthread_mutex_destroy(&planificador->deques[i].mutex);
+        free(planificador->deques[i].datos);
+    }
+
+    pthread_cond_destroy(&planificador->hay_trabajo);
+    pthread_mutex_destroy(&planificador->mutex);
+    free(planificador->hilos);
+    free(planificador->deques);
+    free(planificador);
+}
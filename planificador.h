@@ -0,0 +1,56 @@
+#ifndef PLANIFICADOR_H
+#define PLANIFICADOR_H
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+/* ******************************************************************
+ *                DEFINICION DE LOS TIPOS DE DATOS
+ * *****************************************************************/
+
+/* Pool de hilos con robo de trabajo. La unidad que se programa es un
+ * trabajo: una cola de tareas que se ejecutan de a una y en orden (por
+ * ejemplo, los comandos de una mesa). Cada trabajo tiene un hilo hogar en
+ * cuya deque se encola cuando recibe tareas; un hilo sin nada que hacer le
+ * roba a otro un trabajo entero, con todas sus tareas pendientes. Un trabajo
+ * nunca se ejecuta en dos hilos a la vez. */
+
+typedef struct planificador planificador_t;
+typedef struct trabajo trabajo_t;
+
+typedef void (*ejecutar_tarea_t)(void* tarea, void* extra);
+
+
+/* ******************************************************************
+ *                    PRIMITIVAS DEL PLANIFICADOR
+ * *****************************************************************/
+
+// Crea el planificador con sus hilos, que ejecutan cada tarea con
+// ejecutar(tarea, extra).
+// Pre: hilos > 0.
+// Post: devuelve NULL en caso de error.
+planificador_t* planificador_crear(size_t hilos, ejecutar_tarea_t ejecutar, void* extra);
+
+// Crea un trabajo sin tareas, asignandole un hilo hogar.
+// Post: devuelve NULL en caso de error.
+trabajo_t* trabajo_crear(planificador_t* planificador);
+
+// Agrega una tarea al final del trabajo y lo programa si estaba inactivo.
+// Devuelve false en caso de error o si el trabajo ya fue cerrado.
+bool planificador_encolar(planificador_t* planificador, trabajo_t* trabajo, void* tarea);
+
+// Indica que el trabajo no va a recibir mas tareas. Cuando termine las
+// pendientes se destruye y se llama a destruir(dato), en el hilo que lo
+// este ejecutando o en este mismo si ya estaba inactivo.
+void trabajo_cerrar(trabajo_t* trabajo, void destruir(void*), void* dato);
+
+// Destruye un trabajo.
+// Pre: no tiene tareas pendientes y el planificador ya fue destruido, o el
+// trabajo nunca recibio tareas.
+void trabajo_destruir(trabajo_t* trabajo);
+
+// Ejecuta todas las tareas pendientes, espera a los hilos y destruye el
+// planificador.
+void planificador_destruir(planificador_t* planificador);
+
+#endif // PLANIFICADOR_H
@@ -0,0 +1,166 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "auditoria.h"
+#include "sha256.h"
+
+/*
+ Pruebas de la deteccion de alteraciones en el registro de auditoria.
+
+ Se escribe un registro con dos segmentos llenos y uno parcial, que tiene
+ que verificar. Cada alteracion se aplica a una copia, que no tiene que
+ verificar: un byte de una boleta cambiado, el archivo truncado (sin el
+ ultimo byte del cierre, o por la mitad) y los sellos de los dos primeros
+ segmentos intercambiados.
+
+ Uso: pruebas_auditoria
+*/
+
+#define CARGOS 3
+#define BOLETAS (2 * AUDITORIA_BOLETAS_POR_SEGMENTO + 100)
+#define HILOS 4
+
+// Formato del archivo, como esta documentado en auditoria.h
+#define CABECERA_BYTES 16
+#define REGISTRO_BYTES (8 + 4 * CARGOS)
+#define SELLO_BYTES (4 + 2 * SHA256_BYTES)
+#define SEGMENTO_BYTES (AUDITORIA_BOLETAS_POR_SEGMENTO * REGISTRO_BYTES + SELLO_BYTES)
+
+static size_t fallas = 0;
+
+static void verificar(bool condicion, const char* descripcion) {
+    if(condicion) return;
+    fprintf(stderr, "FALLA: %s\n", descripcion);
+    fallas++;
+}
+
+/* Verifica un registro sin el informe por stdout de auditoria_verificar */
+static bool registro_valido(const char* nombre) {
+    fflush(stdout);
+    int salida = dup(STDOUT_FILENO);
+    int nulo = open("/dev/null", O_WRONLY);
+    if(salida < 0 || nulo < 0 || dup2(nulo, STDOUT_FILENO) < 0) return false;
+    close(nulo);
+
+    char* const nombres[] = { (char*) nombre };
+    bool valido = auditoria_verificar(nombres, 1, HILOS);
+
+    fflush(stdout);
+    dup2(salida, STDOUT_FILENO);
+    close(salida);
+    return valido;
+}
+
+/* Lee el archivo entero.
+ Post: devuelve NULL en caso de error. */
+static uint8_t* leer_archivo(const char* nombre, size_t* largo) {
+    FILE* archivo = fopen(nombre, "rb");
+    if(!archivo) return NULL;
+
+    uint8_t* datos = NULL;
+    if(fseek(archivo, 0, SEEK_END) == 0 && (*largo = (size_t) ftell(archivo)) > 0 && fseek(archivo, 0, SEEK_SET) == 0)
+        datos = malloc(*largo);
+    if(datos && fread(datos, 1, *largo, archivo) != *largo)
+    {
+        free(datos);
+        datos = NULL;
+    }
+    fclose(archivo);
+    return datos;
+}
+
+static bool escribir_archivo(const char* nombre, const uint8_t* datos, size_t largo) {
+    FILE* archivo = fopen(nombre, "wb");
+    if(!archivo) return false;
+    bool escrito = fwrite(datos, 1, largo, archivo) == largo;
+    return fclose(archivo) == 0 && escrito;
+}
+
+/* Escribe el registro de BOLETAS boletas: la boleta i vota al partido i % 5
+ en cada cargo, corrido por el cargo */
+static bool escribir_registro(const char* nombre) {
+    auditoria_t* auditoria = auditoria_crear(nombre, CARGOS);
+    if(!auditoria) return false;
+
+    uint32_t partidos[CARGOS];
+    for(uint32_t boleta=0;boleta<BOLETAS;boleta++)
+    {
+        for(uint32_t cargo=0;cargo<CARGOS;cargo++)
+            partidos[cargo] = (boleta + cargo) % 5;
+        auditoria_registrar(auditoria, partidos);
+    }
+    return auditoria_cerrar(auditoria);
+}
+
+static void prueba_alteraciones(const char* directorio) {
+    char nombre[512], copia[512];
+    snprintf(nombre, sizeof(nombre), "%s/mesa.aud", directorio);
+    snprintf(copia, sizeof(copia), "%s/copia.aud", directorio);
+
+    verificar(escribir_registro(nombre), "escribir el registro");
+    verificar(registro_valido(nombre), "el registro sin alterar verifica");
+
+    size_t largo = 0;
+    uint8_t* original = leer_archivo(nombre, &largo);
+    uint8_t* alterado = original ? malloc(largo) : NULL;
+    verificar(alterado && largo > CABECERA_BYTES + 2 * SEGMENTO_BYTES, "leer el registro");
+    if(!alterado || largo <= CABECERA_BYTES + 2 * SEGMENTO_BYTES)
+    {
+        free(original);
+        free(alterado);
+        remove(nombre);
+        return;
+    }
+
+    // Un byte del partido votado en la boleta 6, del primer segmento
+    memcpy(alterado, original, largo);
+    alterado[CABECERA_BYTES + 5 * REGISTRO_BYTES + 8] ^= 1;
+    verificar(escribir_archivo(copia, alterado, largo) && !registro_valido(copia), "detectar una boleta alterada");
+
+    // Lo mismo en el segmento parcial
+    memcpy(alterado, original, largo);
+    alterado[CABECERA_BYTES + 2 * SEGMENTO_BYTES + 50 * REGISTRO_BYTES + 8] ^= 1;
+    verificar(escribir_archivo(copia, alterado, largo) && !registro_valido(copia), "detectar una boleta alterada en el segmento parcial");
+
+    verificar(escribir_archivo(copia, original, largo - 1) && !registro_valido(copia), "detectar el cierre truncado");
+    verificar(escribir_archivo(copia, original, largo / 2) && !registro_valido(copia), "detectar el archivo truncado");
+
+    // Los sellos de los dos primeros segmentos intercambiados
+    memcpy(alterado, original, largo);
+    uint8_t* primero = alterado + CABECERA_BYTES + SEGMENTO_BYTES - SELLO_BYTES;
+    uint8_t* segundo = primero + SEGMENTO_BYTES;
+    uint8_t sello[SELLO_BYTES];
+    memcpy(sello, primero, SELLO_BYTES);
+    memcpy(primero, segundo, SELLO_BYTES);
+    memcpy(segundo, sello, SELLO_BYTES);
+    verificar(escribir_archivo(copia, alterado, largo) && !registro_valido(copia), "detectar sellos intercambiados");
+
+    verificar(registro_valido(nombre), "el original sigue verificando");
+
+    free(original);
+    free(alterado);
+    remove(nombre);
+    remove(copia);
+}
+
+int main(void) {
+    char directorio[] = "/tmp/pruebas_auditoria.XXXXXX";
+    if(!mkdtemp(directorio))
+    {
+        perror("mkdtemp");
+        return 2;
+    }
+
+    prueba_alteraciones(directorio);
+    rmdir(directorio);
+
+    printf("auditoria: %s\n", fallas ? "FALLA" : "OK");
+    return fallas ? 1 : 0;
+}
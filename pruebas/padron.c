@@ -0,0 +1,332 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "archivos.h"
+#include "bloom.h"
+#include "padron.h"
+#include "votante_partido.h"
+
+/*
+ Pruebas del padron que no se ven desde los comandos.
+
+ filtro compartido: un proceso carga el padron y guarda su filtro, y otro
+ proceso, que interno los tipos de documento en otro orden, abre el mismo
+ padron diferido con ese filtro. Todos los empadronados se tienen que
+ encontrar: el filtro no puede depender del id que cada proceso le dio a un tipo.
+
+ disposiciones: un padron con campos entre comillas, CRLF y lineas vacias se
+ carga en cada disposicion, y todas tienen que encontrar a los mismos votantes.
+
+ padrones unidos: cuatro archivos, con votantes en varios de ellos, filas
+ repetidas dentro de uno y el mismo numero con distintos tipos, se cargan
+ juntos. Tiene que quedar cada votante una vez, en orden, y cada votante
+ repetido entre archivos se informa en una sola linea con todos sus archivos.
+
+ indice guardado: un proceso abre diferido un padron de varias secciones, con
+ numeros desordenados y un tipo que solo aparece al final, y guarda su
+ indice. Otro proceso lo abre desde ese indice: tiene que conocer el tipo sin
+ recorrer el archivo y encontrar a los mismos votantes.
+
+ Uso: pruebas_padron
+*/
+
+static const char* PADRON = "Tipo,Numero\nLE,5\nDNI,7\nCI,11\nDNI,12\n";
+
+typedef struct documento {
+    const char* tipo;
+    uint64_t numero;
+    bool empadronado;
+} documento_t;
+
+static const documento_t DOCUMENTOS[] = {
+    { "LE", 5, true }, { "DNI", 7, true }, { "CI", 11, true }, { "DNI", 12, true },
+    { "DNI", 5, false }, { "LE", 7, false }, { "CI", 12, false }
+};
+#define CANTIDAD_DOCUMENTOS (sizeof(DOCUMENTOS) / sizeof(DOCUMENTOS[0]))
+
+// Filas entre comillas (con saltos y comillas escapadas), CRLF y sin fin de linea
+static const char* PADRON_CSV = "Tipo,Numero\r\n\"DNI\",77777\r\n\r\nLE,\"5\"\r\n\"C\nI\",9\r\n\"D\"\"NI\",3\nDNI,8";
+
+static const documento_t DOCUMENTOS_CSV[] = {
+    { "DNI", 77777, true }, { "LE", 5, true }, { "C\nI", 9, true }, { "D\"NI", 3, true }, { "DNI", 8, true },
+    { "DNI", 5, false }, { "CI", 9, false }, { "DNI", 3, false }
+};
+#define CANTIDAD_DOCUMENTOS_CSV (sizeof(DOCUMENTOS_CSV) / sizeof(DOCUMENTOS_CSV[0]))
+
+static size_t fallas = 0;
+
+static void verificar(bool condicion, const char* descripcion) {
+    if(condicion) return;
+    fprintf(stderr, "FALLA: %s\n", descripcion);
+    fallas++;
+}
+
+/* Proceso que carga el padron completo y guarda su filtro */
+static int guardar_filtro(const char* padron, const char* filtro) {
+    size_t cantidad;
+    uint64_t* claves = cargar_padron(padron, &cantidad);
+    padron_t* cargado = claves ? padron_crear(claves, cantidad, PADRON_HASH) : NULL;
+    bool guardado = cargado && padron_guardar_filtro(cargado, filtro, firma_archivo(padron));
+    padron_destruir(cargado);
+    documento_tipos_destruir();
+    return guardado ? 0 : 1;
+}
+
+static void prueba_filtro_compartido(const char* directorio) {
+    char padron[512], filtro[512];
+    snprintf(padron, sizeof(padron), "%s/padron.csv", directorio);
+    snprintf(filtro, sizeof(filtro), "%s/padron.bloom", directorio);
+
+    FILE* archivo = fopen(padron, "w");
+    verificar(archivo && fputs(PADRON, archivo) >= 0 && fclose(archivo) == 0, "escribir el padron");
+
+    pid_t hijo = fork();
+    if(hijo == 0) _exit(guardar_filtro(padron, filtro));
+    int estado;
+    verificar(hijo > 0 && waitpid(hijo, &estado, 0) == hijo && WIFEXITED(estado) && WEXITSTATUS(estado) == 0, "guardar el filtro en otro proceso");
+
+    bloom_t* guardado = bloom_cargar(filtro, firma_archivo(padron));
+    verificar(guardado != NULL, "el filtro guardado corresponde al padron");
+    bloom_destruir(guardado);
+
+    // Los tipos en el orden inverso al del archivo, como en un proceso que
+    // antes cargo otro padron.
+    uint64_t clave;
+    verificar(documento_clave_internar("CI", 1, &clave) && documento_clave_internar("DNI", 1, &clave), "internar tipos");
+
+    padron_t* diferido = padron_abrir_diferido(padron, filtro);
+    verificar(diferido != NULL, "abrir el padron diferido");
+    if(!diferido) return;
+
+    for(size_t i=0;i<CANTIDAD_DOCUMENTOS;i++)
+    {
+        const documento_t* documento = &DOCUMENTOS[i];
+        bool encontrado = documento_clave(documento->tipo, documento->numero, &clave) && padron_buscar(diferido, clave) != PADRON_AUSENTE;
+        if(encontrado != documento->empadronado)
+            fprintf(stderr, "%s %llu: %s\n", documento->tipo, (unsigned long long) documento->numero, encontrado ? "encontrado" : "no encontrado");
+        verificar(encontrado == documento->empadronado, "buscar en el padron diferido con el filtro de otro proceso");
+    }
+    padron_destruir(diferido);
+
+    char indice[520];
+    snprintf(indice, sizeof(indice), "%s.indice", filtro);
+    remove(padron);
+    remove(filtro);
+    remove(indice);
+}
+
+static void prueba_disposiciones(const char* directorio) {
+    char padron[512];
+    snprintf(padron, sizeof(padron), "%s/padron_csv.csv", directorio);
+
+    FILE* archivo = fopen(padron, "w");
+    verificar(archivo && fputs(PADRON_CSV, archivo) >= 0 && fclose(archivo) == 0, "escribir el padron");
+
+    const padron_disposicion_t disposiciones[] = { PADRON_HASH, PADRON_EYTZINGER, PADRON_COMPRIMIDO, PADRON_DIFERIDO };
+    for(size_t d=0;d<sizeof(disposiciones)/sizeof(disposiciones[0]);d++)
+    {
+        padron_t* cargado;
+        if(disposiciones[d] == PADRON_DIFERIDO)
+            cargado = padron_abrir_diferido(padron, NULL);
+        else
+        {
+            size_t cantidad;
+            uint64_t* claves = cargar_padron(padron, &cantidad);
+            cargado = claves ? padron_crear(claves, cantidad, disposiciones[d]) : NULL;
+        }
+        verificar(cargado != NULL, "cargar el padron");
+        if(!cargado) continue;
+
+        for(size_t i=0;i<CANTIDAD_DOCUMENTOS_CSV;i++)
+        {
+            const documento_t* documento = &DOCUMENTOS_CSV[i];
+
+            uint64_t clave;
+            bool encontrado = documento_clave(documento->tipo, documento->numero, &clave) && padron_buscar(cargado, clave) != PADRON_AUSENTE;
+            if(encontrado != documento->empadronado)
+                fprintf(stderr, "disposicion %zu, %s %llu: %s\n", d, documento->tipo, (unsigned long long) documento->numero, encontrado ? "encontrado" : "no encontrado");
+            verificar(encontrado == documento->empadronado, "todas las disposiciones leen las mismas filas");
+        }
+        padron_destruir(cargado);
+    }
+    remove(padron);
+}
+
+// Archivos de prueba_padrones_unidos, y los votantes que quedan al unirlos
+static const char* PADRONES_UNIDOS[] = {
+    "Tipo,Numero\nDNI,1\nDNI,3\nLE,5\nDNI,5\nDNI,9\nDNI,3\n",
+    "Tipo,Numero\nDNI,5\nLE,2\nDNI,7\nCI,5\n",
+    "Tipo,Numero\nDNI,10\nLE,5\nDNI,7\nDNI,5\n",
+    "Tipo,Numero\n"
+};
+#define CANTIDAD_PADRONES_UNIDOS (sizeof(PADRONES_UNIDOS) / sizeof(PADRONES_UNIDOS[0]))
+
+static const documento_t DOCUMENTOS_UNIDOS[] = {
+    { "DNI", 1, true }, { "DNI", 3, true }, { "DNI", 5, true }, { "DNI", 7, true }, { "DNI", 9, true },
+    { "DNI", 10, true }, { "LE", 2, true }, { "LE", 5, true }, { "CI", 5, true }
+};
+#define CANTIDAD_DOCUMENTOS_UNIDOS (sizeof(DOCUMENTOS_UNIDOS) / sizeof(DOCUMENTOS_UNIDOS[0]))
+
+/* Cuenta las lineas del informe que empiezan con prefijo */
+static size_t contar_lineas(const char* informe, const char* prefijo) {
+    size_t lineas = 0;
+    for(const char* linea=informe;*linea;)
+    {
+        lineas += strncmp(linea, prefijo, strlen(prefijo)) == 0;
+        const char* fin = strchr(linea, '\n');
+        if(!fin) break;
+        linea = fin + 1;
+    }
+    return lineas;
+}
+
+static void prueba_padrones_unidos(const char* directorio) {
+    char nombres[CANTIDAD_PADRONES_UNIDOS * 512] = "", nombre[512], informe_nombre[512];
+    for(size_t i=0;i<CANTIDAD_PADRONES_UNIDOS;i++)
+    {
+        snprintf(nombre, sizeof(nombre), "%s/unido%zu.csv", directorio, i);
+        FILE* archivo = fopen(nombre, "w");
+        verificar(archivo && fputs(PADRONES_UNIDOS[i], archivo) >= 0 && fclose(archivo) == 0, "escribir el padron");
+        if(i) strcat(nombres, ",");
+        strcat(nombres, nombre);
+    }
+
+    // El informe de repetidos va a stderr: se lo lleva a un archivo.
+    snprintf(informe_nombre, sizeof(informe_nombre), "%s/informe.txt", directorio);
+    int informe = open(informe_nombre, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    int error = dup(STDERR_FILENO);
+    verificar(informe >= 0 && error >= 0 && dup2(informe, STDERR_FILENO) >= 0, "redirigir stderr");
+
+    size_t cantidad = 0;
+    uint64_t* claves = cargar_padrones(nombres, &cantidad);
+
+    dup2(error, STDERR_FILENO);
+    close(error);
+    close(informe);
+
+    verificar(claves && cantidad == CANTIDAD_DOCUMENTOS_UNIDOS, "cantidad de votantes unidos");
+    for(size_t i=0;claves && i<cantidad;i++)
+        verificar(!i || claves[i-1] < claves[i], "votantes unidos en orden y sin repetidos");
+    for(size_t i=0;claves && i<CANTIDAD_DOCUMENTOS_UNIDOS;i++)
+    {
+        uint64_t clave;
+        bool encontrado = false;
+        for(size_t j=0;j<cantidad && documento_clave(DOCUMENTOS_UNIDOS[i].tipo, DOCUMENTOS_UNIDOS[i].numero, &clave);j++)
+            encontrado = encontrado || claves[j] == clave;
+        verificar(encontrado, "cada votante de los archivos queda en el padron unido");
+    }
+    free(claves);
+
+    size_t largo = 0;
+    FILE* archivo = fopen(informe_nombre, "r");
+    char texto[4096];
+    if(archivo)
+    {
+        largo = fread(texto, 1, sizeof(texto) - 1, archivo);
+        fclose(archivo);
+    }
+    texto[largo] = '\0';
+
+    char esperada[2048];
+    snprintf(esperada, sizeof(esperada), "Padron: DNI 5 en %s/unido0.csv y en %s/unido1.csv y en %s/unido2.csv\n", directorio, directorio, directorio);
+    verificar(contar_lineas(texto, "Padron: DNI 5 ") == 1 && strstr(texto, esperada), "informar una vez al votante en tres archivos");
+    verificar(contar_lineas(texto, "Padron: LE 5 ") == 1, "informar una vez al votante en dos archivos");
+    verificar(contar_lineas(texto, "Padron: DNI 7 ") == 1, "informar una vez al votante en dos archivos");
+    verificar(contar_lineas(texto, "Padron: CI 5 ") == 0, "el mismo numero con otro tipo no es un repetido");
+    verificar(strstr(texto, "Padron: 3 votantes en mas de un archivo\n"), "contar los votantes repetidos entre archivos");
+    verificar(contar_lineas(texto, "Padron: ") == 5, "informar las filas repetidas dentro de un archivo");
+
+    for(size_t i=0;i<CANTIDAD_PADRONES_UNIDOS;i++)
+    {
+        snprintf(nombre, sizeof(nombre), "%s/unido%zu.csv", directorio, i);
+        remove(nombre);
+    }
+    remove(informe_nombre);
+}
+
+// Filas del padron de prueba_indice_guardado: mas de una seccion
+#define FILAS_INDICE 5000
+
+/* Numero de la fila i del padron de prueba_indice_guardado, desordenado */
+static uint64_t numero_indice(size_t i) {
+    return (uint64_t) (i * 7919 % FILAS_INDICE) * 2 + 1;
+}
+
+/* Busca en el padron diferido cada fila de prueba_indice_guardado, y los
+ numeros pares, que no estan.
+ Post: devuelve la cantidad de busquedas erradas. */
+static size_t buscar_indice(const char* padron, const char* filtro) {
+    padron_t* diferido = padron_abrir_diferido(padron, filtro);
+    if(!diferido) return 1;
+
+    size_t erradas = !documento_tipo_conocido("PAS");
+    for(size_t i=0;i<FILAS_INDICE;i++)
+    {
+        const char* tipo = i + 1 == FILAS_INDICE ? "PAS" : "DNI";
+        uint64_t clave;
+        erradas += !documento_clave(tipo, numero_indice(i), &clave) || padron_buscar(diferido, clave) == PADRON_AUSENTE;
+        erradas += documento_clave("DNI", numero_indice(i) + 1, &clave) && padron_buscar(diferido, clave) != PADRON_AUSENTE;
+    }
+    padron_destruir(diferido);
+    return erradas;
+}
+
+/* Proceso que abre el padron diferido y busca a todos */
+static int buscar_en_proceso(const char* padron, const char* filtro) {
+    size_t erradas = buscar_indice(padron, filtro);
+    documento_tipos_destruir();
+    return erradas ? 1 : 0;
+}
+
+static void prueba_indice_guardado(const char* directorio) {
+    char padron[512], filtro[512], indice[520];
+    snprintf(padron, sizeof(padron), "%s/padron_indice.csv", directorio);
+    snprintf(filtro, sizeof(filtro), "%s/padron_indice.bloom", directorio);
+    snprintf(indice, sizeof(indice), "%s.indice", filtro);
+
+    FILE* archivo = fopen(padron, "w");
+    bool escrito = archivo && fputs("Tipo,Numero\n", archivo) >= 0;
+    for(size_t i=0;escrito && i<FILAS_INDICE;i++)
+        escrito = fprintf(archivo, "%s,%llu\n", i + 1 == FILAS_INDICE ? "PAS" : "DNI", (unsigned long long) numero_indice(i)) > 0;
+    verificar(archivo && escrito && fclose(archivo) == 0, "escribir el padron");
+
+    pid_t hijo = fork();
+    if(hijo == 0) _exit(buscar_en_proceso(padron, filtro));
+    int estado;
+    verificar(hijo > 0 && waitpid(hijo, &estado, 0) == hijo && WIFEXITED(estado) && WEXITSTATUS(estado) == 0, "buscar en el padron diferido recorrido");
+    verificar(access(indice, F_OK) == 0, "guardar el indice junto al filtro");
+
+    hijo = fork();
+    if(hijo == 0) _exit(buscar_en_proceso(padron, filtro));
+    verificar(hijo > 0 && waitpid(hijo, &estado, 0) == hijo && WIFEXITED(estado) && WEXITSTATUS(estado) == 0, "buscar en el padron diferido abierto desde el indice");
+
+    remove(padron);
+    remove(indice);
+}
+
+int main(void) {
+    char directorio[] = "/tmp/pruebas_padron.XXXXXX";
+    if(!mkdtemp(directorio))
+    {
+        perror("mkdtemp");
+        return 2;
+    }
+
+    prueba_filtro_compartido(directorio);
+    prueba_disposiciones(directorio);
+    prueba_padrones_unidos(directorio);
+    prueba_indice_guardado(directorio);
+    documento_tipos_destruir();
+    rmdir(directorio);
+
+    printf("padron: %s\n", fallas ? "FALLA" : "OK");
+    return fallas ? 1 : 0;
+}
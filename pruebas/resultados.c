@@ -0,0 +1,125 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include "resultados.h"
+
+/*
+ Pruebas de los resultados publicados en memoria compartida.
+
+ lectura concurrente: un proceso lee el segmento mientras otro cuenta
+ boletas. Cada copia tiene que ser un estado que la mesa realmente tuvo: la
+ boleta i vota al partido i % PARTIDOS en todos los cargos, asi que las
+ boletas contadas determinan todos los votos.
+
+ segmento persistente: despues de que la mesa lo libera, el segmento sigue
+ abierto con los resultados finales.
+
+ Uso: pruebas_resultados
+*/
+
+#define PARTIDOS 3
+#define CARGOS 4
+#define BOLETAS 200000
+
+static size_t fallas = 0;
+
+static void verificar(bool condicion, const char* descripcion) {
+    if(condicion) return;
+    fprintf(stderr, "FALLA: %s\n", descripcion);
+    fallas++;
+}
+
+/* Devuelve true si la copia es el estado despues de contar sus boletas */
+static bool copia_consistente(const resultados_bloque_t* copia) {
+    if(copia->partidos != PARTIDOS || copia->cargos != CARGOS || copia->votantes != copia->boletas)
+        return false;
+
+    for(uint64_t partido=0;partido<PARTIDOS;partido++)
+    {
+        uint64_t esperados = copia->boletas / PARTIDOS + (partido < copia->boletas % PARTIDOS);
+        for(uint64_t cargo=0;cargo<CARGOS;cargo++)
+            if(copia->votos[partido * CARGOS + cargo] != esperados) return false;
+    }
+    return true;
+}
+
+/* Proceso que lee el segmento hasta que la mesa se cierra */
+static int leer_hasta_cerrar(const char* nombre) {
+    resultados_t* resultados = resultados_abrir(nombre);
+    resultados_bloque_t* copia = resultados ? malloc(resultados_tamanio(resultados)) : NULL;
+    if(!copia) return 1;
+
+    uint64_t anteriores = 0;
+    bool consistente = true;
+    do
+    {
+        resultados_leer(resultados, copia);
+        consistente = copia_consistente(copia) && copia->boletas >= anteriores;
+        anteriores = copia->boletas;
+    } while(consistente && !copia->cerrada);
+
+    if(consistente && copia->boletas != BOLETAS) consistente = false;
+
+    free(copia);
+    resultados_destruir(resultados);
+    return consistente ? 0 : 1;
+}
+
+static void prueba_lectura_concurrente(const char* nombre) {
+    resultados_t* mesa = resultados_crear(nombre, PARTIDOS, CARGOS);
+    verificar(mesa, "crear el segmento");
+    if(!mesa) return;
+
+    pid_t hijo = fork();
+    if(hijo == 0) _exit(leer_hasta_cerrar(nombre));
+    verificar(hijo > 0, "crear el proceso lector");
+
+    size_t contadores[CARGOS];
+    for(uint64_t boleta=0;boleta<BOLETAS;boleta++)
+    {
+        size_t partido = (size_t) (boleta % PARTIDOS);
+        for(size_t cargo=0;cargo<CARGOS;cargo++)
+            contadores[cargo] = partido * CARGOS + cargo;
+        resultados_publicar_boleta(mesa, contadores, CARGOS, boleta + 1);
+    }
+    resultados_cerrar_mesa(mesa);
+    resultados_destruir(mesa);
+
+    int estado = 1;
+    if(hijo > 0) waitpid(hijo, &estado, 0);
+    verificar(WIFEXITED(estado) && WEXITSTATUS(estado) == 0, "el lector solo ve estados consistentes");
+}
+
+static void prueba_segmento_persistente(const char* nombre) {
+    resultados_t* resultados = resultados_abrir(nombre);
+    verificar(resultados, "el segmento sigue publicado despues de la mesa");
+    if(!resultados) return;
+
+    resultados_bloque_t* copia = malloc(resultados_tamanio(resultados));
+    if(copia)
+    {
+        resultados_leer(resultados, copia);
+        verificar(copia->cerrada && copia->boletas == BOLETAS && copia_consistente(copia), "resultados finales");
+    }
+    free(copia);
+    resultados_destruir(resultados);
+}
+
+int main(void) {
+    char nombre[64];
+    snprintf(nombre, sizeof(nombre), "/pruebas_resultados.%ld", (long) getpid());
+
+    prueba_lectura_concurrente(nombre);
+    prueba_segmento_persistente(nombre);
+    shm_unlink(nombre);
+
+    printf("resultados: %s\n", fallas ? "FALLA" : "OK");
+    return fallas ? 1 : 0;
+}
@@ -0,0 +1,209 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "resultados.h"
+
+// Cada cuanto revisa el monitor si cambiaron los resultados
+#define MONITOR_ESPERA_NS 100000000L
+
+struct resultados {
+    resultados_bloque_t* bloque;
+    // Bytes del bloque, y los que se mapearon (un lector mapea todo el segmento)
+    size_t tamanio;
+    size_t mapeado;
+};
+
+static size_t tamanio_bloque(uint64_t partidos, uint64_t cargos) {
+    return sizeof(resultados_bloque_t) + (size_t) (partidos * cargos) * sizeof(uint64_t);
+}
+
+/* Suma uno a un campo. Solo el escritor modifica el bloque: no hace falta
+ * una suma atomica, solo que los lectores no vean la mitad de una escritura. */
+static void incrementar(uint64_t* campo) {
+    __atomic_store_n(campo, __atomic_load_n(campo, __ATOMIC_RELAXED) + 1, __ATOMIC_RELAXED);
+}
+
+/* La secuencia impar avisa a los lectores que el bloque esta cambiando. La
+ * barrera impide que las escrituras siguientes se vean antes que ella. */
+static void empezar_escritura(resultados_bloque_t* bloque) {
+    incrementar(&bloque->secuencia);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static void terminar_escritura(resultados_bloque_t* bloque) {
+    __atomic_store_n(&bloque->secuencia, __atomic_load_n(&bloque->secuencia, __ATOMIC_RELAXED) + 1, __ATOMIC_RELEASE);
+}
+
+resultados_t* resultados_crear(const char* nombre, size_t partidos, size_t cargos) {
+    resultados_t* resultados = malloc(sizeof(resultados_t));
+    if(!resultados) return NULL;
+
+    resultados->tamanio = tamanio_bloque(partidos, cargos);
+    resultados->mapeado = resultados->tamanio;
+
+    // Un segmento nuevo, no el anterior: achicarlo haria fallar a quien lo
+    // tenga mapeado.
+    shm_unlink(nombre);
+    int fd = shm_open(nombre, O_CREAT | O_EXCL | O_RDWR, 0644);
+    if(fd < 0) { free(resultados); return NULL; }
+
+    void* bloque = MAP_FAILED;
+    if(ftruncate(fd, (off_t) resultados->tamanio) == 0)
+        bloque = mmap(NULL, resultados->tamanio, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(bloque == MAP_FAILED)
+    {
+        shm_unlink(nombre);
+        free(resultados);
+        return NULL;
+    }
+
+    // ftruncate lo deja en cero: falta el encabezado, con la magia al final
+    // para que un lector no use el bloque antes de que este completo.
+    resultados->bloque = bloque;
+    resultados->bloque->version = RESULTADOS_VERSION;
+    resultados->bloque->partidos = partidos;
+    resultados->bloque->cargos = cargos;
+    __atomic_store_n(&resultados->bloque->magia, RESULTADOS_MAGIA, __ATOMIC_RELEASE);
+    return resultados;
+}
+
+void resultados_publicar_boleta(resultados_t* resultados, const size_t* contadores, size_t cantidad, uint64_t votantes) {
+    resultados_bloque_t* bloque = resultados->bloque;
+
+    empezar_escritura(bloque);
+    for(size_t i=0;i<cantidad;i++)
+        incrementar(&bloque->votos[contadores[i]]);
+    incrementar(&bloque->boletas);
+    __atomic_store_n(&bloque->votantes, votantes, __ATOMIC_RELAXED);
+    terminar_escritura(bloque);
+}
+
+void resultados_cerrar_mesa(resultados_t* resultados) {
+    empezar_escritura(resultados->bloque);
+    __atomic_store_n(&resultados->bloque->cerrada, 1, __ATOMIC_RELAXED);
+    terminar_escritura(resultados->bloque);
+}
+
+resultados_t* resultados_abrir(const char* nombre) {
+    int fd = shm_open(nombre, O_RDONLY, 0);
+    if(fd < 0) return NULL;
+
+    struct stat estado;
+    void* bloque = MAP_FAILED;
+    if(fstat(fd, &estado) == 0 && (size_t) estado.st_size >= sizeof(resultados_bloque_t))
+        bloque = mmap(NULL, (size_t) estado.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if(bloque == MAP_FAILED) return NULL;
+
+    // Los contadores tienen que entrar en lo que se mapeo.
+    resultados_bloque_t* encabezado = bloque;
+    uint64_t partidos = encabezado->partidos, cargos = encabezado->cargos;
+    if(__atomic_load_n(&encabezado->magia, __ATOMIC_ACQUIRE) != RESULTADOS_MAGIA || encabezado->version != RESULTADOS_VERSION
+       || (cargos && partidos > (uint64_t) estado.st_size / sizeof(uint64_t) / cargos)
+       || tamanio_bloque(partidos, cargos) > (size_t) estado.st_size)
+    {
+        munmap(bloque, (size_t) estado.st_size);
+        return NULL;
+    }
+
+    resultados_t* resultados = malloc(sizeof(resultados_t));
+    if(!resultados) { munmap(bloque, (size_t) estado.st_size); return NULL; }
+
+    resultados->bloque = bloque;
+    resultados->tamanio = tamanio_bloque(partidos, cargos);
+    resultados->mapeado = (size_t) estado.st_size;
+    return resultados;
+}
+
+size_t resultados_tamanio(const resultados_t* resultados) {
+    return resultados->tamanio;
+}
+
+void resultados_leer(const resultados_t* resultados, resultados_bloque_t* copia) {
+    resultados_bloque_t* bloque = resultados->bloque;
+    size_t contadores = (size_t) (bloque->partidos * bloque->cargos);
+
+    copia->magia = bloque->magia;
+    copia->version = bloque->version;
+    copia->partidos = bloque->partidos;
+    copia->cargos = bloque->cargos;
+
+    for(;;)
+    {
+        uint64_t secuencia = __atomic_load_n(&bloque->secuencia, __ATOMIC_ACQUIRE);
+        if(secuencia & 1) continue;
+
+        copia->boletas = __atomic_load_n(&bloque->boletas, __ATOMIC_RELAXED);
+        copia->votantes = __atomic_load_n(&bloque->votantes, __ATOMIC_RELAXED);
+        copia->cerrada = __atomic_load_n(&bloque->cerrada, __ATOMIC_RELAXED);
+        for(size_t i=0;i<contadores;i++)
+            copia->votos[i] = __atomic_load_n(&bloque->votos[i], __ATOMIC_RELAXED);
+
+        // Si la secuencia no cambio, nada de lo copiado se escribio en el medio.
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if(__atomic_load_n(&bloque->secuencia, __ATOMIC_RELAXED) == secuencia)
+        {
+            copia->secuencia = secuencia;
+            return;
+        }
+    }
+}
+
+static void mostrar_resultados(const resultados_bloque_t* copia) {
+    printf("Boletas: %llu\n", (unsigned long long) copia->boletas);
+    printf("Votantes: %llu\n", (unsigned long long) copia->votantes);
+    for(uint64_t partido=0;partido<copia->partidos;partido++)
+    {
+        printf("Partido %llu:", (unsigned long long) partido + 1);
+        for(uint64_t cargo=0;cargo<copia->cargos;cargo++)
+            printf(" %llu", (unsigned long long) copia->votos[partido * copia->cargos + cargo]);
+        printf("\n");
+    }
+    if(copia->cerrada) printf("Mesa cerrada\n");
+    printf("\n");
+    fflush(stdout);
+}
+
+bool resultados_monitorear(const char* nombre) {
+    resultados_t* resultados = resultados_abrir(nombre);
+    if(!resultados) return false;
+
+    resultados_bloque_t* copia = malloc(resultados_tamanio(resultados));
+    if(!copia) { resultados_destruir(resultados); return false; }
+
+    // La secuencia de la copia solo cambia si cambio algun numero, y nunca es
+    // impar: la primera lectura siempre se muestra.
+    const struct timespec espera = { 0, MONITOR_ESPERA_NS };
+    uint64_t mostrada = 1;
+    for(;;)
+    {
+        resultados_leer(resultados, copia);
+        if(copia->secuencia != mostrada)
+        {
+            mostrar_resultados(copia);
+            mostrada = copia->secuencia;
+        }
+        if(copia->cerrada) break;
+        nanosleep(&espera, NULL);
+    }
+
+    free(copia);
+    resultados_destruir(resultados);
+    return true;
+}
+
+void resultados_destruir(resultados_t* resultados) {
+    if(!resultados) return;
+    munmap(resultados->bloque, resultados->mapeado);
+    free(resultados);
+}
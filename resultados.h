@@ -0,0 +1,87 @@
+#ifndef RESULTADOS_H
+#define RESULTADOS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/* ******************************************************************
+ *                DEFINICION DE LOS TIPOS DE DATOS
+ * *****************************************************************/
+
+/* Resultados de una mesa publicados en un segmento de memoria compartida
+ * POSIX, para que otros procesos (tableros, monitores) los lean sin pasar
+ * por los comandos. La mesa es el unico escritor y actualiza el bloque con
+ * un seqlock: los lectores copian el bloque sin llamadas al sistema ni
+ * locks, y reintentan si la secuencia cambio mientras copiaban. */
+
+#define RESULTADOS_MAGIA 0x53455252u
+#define RESULTADOS_VERSION 1
+
+/* Formato del segmento. Todos los campos se leen y escriben de forma atomica;
+ * un lector debe usar resultados_leer, o repetir su protocolo. */
+typedef struct resultados_bloque {
+    uint32_t magia;
+    uint32_t version;
+    // Impar mientras la mesa esta actualizando el bloque
+    uint64_t secuencia;
+    uint64_t partidos;
+    uint64_t cargos;
+    // Boletas contadas (votar fin) y votantes que empezaron a votar
+    uint64_t boletas;
+    uint64_t votantes;
+    // Distinto de cero una vez cerrada la mesa: los numeros ya no cambian
+    uint64_t cerrada;
+    // votos[partido * cargos + cargo], en el orden del archivo de listas
+    uint64_t votos[];
+} resultados_bloque_t;
+
+typedef struct resultados resultados_t;
+
+
+/* ******************************************************************
+ *                    PRIMITIVAS DEL ESCRITOR
+ * *****************************************************************/
+
+// Crea el segmento nombre (por ejemplo "/mesa1") con todos los contadores en
+// cero, reemplazando uno anterior del mismo nombre: quien lo tenga abierto
+// sigue viendo el viejo hasta que lo vuelva a abrir. El segmento sobrevive a
+// la mesa, con los resultados finales, hasta que lo borre el operador (por
+// ejemplo, rm /dev/shm/mesa1) o lo reemplace otra mesa.
+// Post: devuelve NULL en caso de error.
+resultados_t* resultados_crear(const char* nombre, size_t partidos, size_t cargos);
+
+// Suma una boleta, con un voto en cada uno de los contadores indicados
+// (partido * cargos + cargo), y publica la cantidad de votantes.
+// Pre: fue creado con resultados_crear; hay un solo escritor.
+void resultados_publicar_boleta(resultados_t* resultados, const size_t* contadores, size_t cantidad, uint64_t votantes);
+
+// Marca la mesa como cerrada.
+// Pre: fue creado con resultados_crear.
+void resultados_cerrar_mesa(resultados_t* resultados);
+
+
+/* ******************************************************************
+ *                    PRIMITIVAS DEL LECTOR
+ * *****************************************************************/
+
+// Abre para lectura un segmento publicado por otro proceso.
+// Post: devuelve NULL si no existe o no tiene el formato esperado.
+resultados_t* resultados_abrir(const char* nombre);
+
+// Devuelve la cantidad de bytes de una copia completa del bloque.
+size_t resultados_tamanio(const resultados_t* resultados);
+
+// Copia en copia (de resultados_tamanio bytes) un estado consistente del
+// bloque, esperando si la mesa lo esta actualizando.
+void resultados_leer(const resultados_t* resultados, resultados_bloque_t* copia);
+
+// Muestra en stdout los resultados publicados en el segmento cada vez que
+// cambian, hasta que la mesa se cierra.
+// Post: devuelve false si el segmento no existe o no tiene el formato esperado.
+bool resultados_monitorear(const char* nombre);
+
+// Libera el segmento, sin borrarlo: sus resultados siguen publicados.
+void resultados_destruir(resultados_t* resultados);
+
+#endif // RESULTADOS_H
@@ -0,0 +1,708 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "servidor.h"
+#include "maquina.h"
+#include "hash.h"
+#include "planificador.h"
+#include "util.h"
+
+// Largo maximo de una linea de comando
+#define ENTRADA_MAXIMA 4096
+// Respuestas pendientes de envio a partir de las cuales se deja de leer la conexion
+#define SALIDA_PENDIENTE_MAXIMA (1 << 20)
+// Idem con comandos encolados que todavia no se ejecutaron
+#define TAREAS_PENDIENTES_MAXIMO 256
+#define EVENTOS_MAXIMO 64
+#define CONEXIONES_EN_ESPERA 128
+
+#define COMANDO_MESA "mesa"
+
+typedef struct mesa {
+    // Identificador de la mesa compartida, o NULL si es propia de una conexion
+    char* id;
+    maquina_votacion_t* maquina;
+    // Comandos de la mesa, que se ejecutan en orden en algun hilo del planificador
+    trabajo_t* trabajo;
+    // Segmento donde la mesa compartida publica sus resultados, o NULL
+    char* segmento;
+    // Registro de auditoria de la mesa, o NULL
+    char* auditoria;
+    // Filtro del padron de la mesa, o NULL
+    char* filtro;
+} mesa_t;
+
+typedef struct conexion {
+    int fd;
+    mesa_t* mesa;
+    // Cuarto oscuro de la conexion en su mesa
+    cabina_t* cabina;
+    // Lineas recibidas que todavia no se ejecutaron
+    char entrada[ENTRADA_MAXIMA];
+    size_t largo_entrada;
+    // La linea actual supero ENTRADA_MAXIMA: se ignora hasta su fin
+    bool descartando;
+    // Respuestas, escritas con salida_establecer mientras se ejecuta cada linea
+    FILE* salida;
+    char* datos_salida;
+    size_t largo_salida;
+    size_t enviado;
+    // El cliente cerro su lado: se cierra al terminar de enviar
+    bool terminada;
+    // Fallo la conexion: se descartan las respuestas
+    bool rota;
+    // Ya se encolo la liberacion de la cabina: no se encola nada mas
+    bool liberada;
+    // Tareas encoladas cuya respuesta todavia no volvio
+    size_t pendientes;
+    // Eventos registrados en epoll
+    uint32_t eventos;
+    // Lista de conexiones abiertas, para cerrarlas al terminar
+    struct conexion* anterior;
+    struct conexion* siguiente;
+} conexion_t;
+
+typedef enum {
+    TAREA_COMANDO,
+    // La linea no entro en el buffer de entrada
+    TAREA_LINEA_LARGA,
+    // Ultima tarea de la conexion: destruye su cabina
+    TAREA_LIBERAR
+} tipo_tarea_t;
+
+/* Una linea de una conexion, ejecutada por el planificador en el trabajo de su mesa */
+typedef struct tarea {
+    tipo_tarea_t tipo;
+    conexion_t* conexion;
+    char* linea;
+    // Respuesta, escrita por el hilo que ejecuto la tarea
+    char* respuesta;
+    size_t largo_respuesta;
+    // No se pudo capturar la respuesta: el comando no corrio y se contesta un error
+    bool sin_salida;
+    // Lista de tareas terminadas
+    struct tarea* siguiente;
+} tarea_t;
+
+typedef struct servidor {
+    int fd;
+    int epoll;
+    // Mesas compartidas, por id
+    hash_t* mesas;
+    // Mesas propias de una conexion creadas hasta ahora, para nombrar sus registros
+    size_t mesas_propias;
+    conexion_t* conexiones;
+    const opciones_maquina_t* opciones;
+    planificador_t* planificador;
+    // Tareas ejecutadas, en orden, que el hilo de epoll tiene que entregar
+    pthread_mutex_t mutex_terminadas;
+    tarea_t* terminadas;
+    tarea_t* ultima_terminada;
+    // eventfd con el que los hilos avisan que hay tareas terminadas
+    int aviso;
+} servidor_t;
+
+static volatile sig_atomic_t terminar_servidor = 0;
+
+static void pedir_terminacion(int senal) {
+    (void) senal;
+    terminar_servidor = 1;
+}
+
+static size_t mesa_hash(const void* dato) {
+    const mesa_t* mesa = dato;
+    // FNV-1a
+    size_t h = (size_t) 2166136261u;
+    for(const char* c = mesa->id; *c; c++)
+        h = (h ^ (unsigned char) *c) * 16777619u;
+    return h;
+}
+
+static bool mesa_iguales(const void* a, const void* b) {
+    return strcmp(((const mesa_t*) a)->id, ((const mesa_t*) b)->id) == 0;
+}
+
+static void mesa_destruir(void* dato) {
+    mesa_t* mesa = dato;
+    maquina_destruir(mesa->maquina);
+    free(mesa->id);
+    free(mesa->segmento);
+    free(mesa->auditoria);
+    free(mesa->filtro);
+    free(mesa);
+}
+
+/* Devuelve <prefijo>.<sufijo>, el nombre de algo propio de una mesa, o NULL si no hay memoria */
+static char* nombre_de_mesa(const char* prefijo, const char* sufijo) {
+    char* nombre = malloc(strlen(prefijo) + strlen(sufijo) + 2);
+    if(nombre) sprintf(nombre, "%s.%s", prefijo, sufijo);
+    return nombre;
+}
+
+static mesa_t* mesa_crear(servidor_t* servidor, const char* id) {
+    mesa_t* mesa = malloc(sizeof(mesa_t));
+    if(!mesa) return NULL;
+
+    mesa->id = NULL;
+    mesa->trabajo = NULL;
+    mesa->maquina = NULL;
+    mesa->segmento = NULL;
+    mesa->auditoria = NULL;
+    mesa->filtro = NULL;
+
+    // Cada mesa compartida publica en su propio segmento, <segmento>.<id>;
+    // las propias de una conexion no publican.
+    opciones_maquina_t opciones = *servidor->opciones;
+    const char* prefijo = opciones.segmento_resultados;
+    opciones.segmento_resultados = NULL;
+    if(id && prefijo)
+        opciones.segmento_resultados = mesa->segmento = nombre_de_mesa(prefijo, id);
+
+    // Idem con el registro de auditoria, <archivo>.<id>, y con el filtro del
+    // padron, que cada abrir reescribe. Las propias tambien llevan los suyos,
+    // porque ninguna mesa cuenta boletas sin registro.
+    char propia[64];
+    if(!id && (opciones.archivo_auditoria || opciones.archivo_filtro))
+        snprintf(propia, sizeof(propia), "propia-%ld-%zu", (long) getpid(), ++servidor->mesas_propias);
+    const char* sufijo = id ? id : propia;
+
+    if(opciones.archivo_auditoria && !(opciones.archivo_auditoria = mesa->auditoria = nombre_de_mesa(opciones.archivo_auditoria, sufijo)))
+        { mesa_destruir(mesa); return NULL; }
+    if(opciones.archivo_filtro && !(opciones.archivo_filtro = mesa->filtro = nombre_de_mesa(opciones.archivo_filtro, sufijo)))
+        { mesa_destruir(mesa); return NULL; }
+
+    mesa->maquina = maquina_crear(&opciones);
+    if(!mesa->maquina || (id && !(mesa->id = copiar_clave(id))) || !(mesa->trabajo = trabajo_crear(servidor->planificador)))
+    {
+        trabajo_destruir(mesa->trabajo);
+        mesa_destruir(mesa);
+        return NULL;
+    }
+    return mesa;
+}
+
+/* Destruye una mesa compartida, una vez destruido el planificador */
+static void mesa_compartida_destruir(void* dato) {
+    mesa_t* mesa = dato;
+    trabajo_destruir(mesa->trabajo);
+    mesa_destruir(mesa);
+}
+
+/* Devuelve la mesa compartida id, creandola si todavia no existe */
+static mesa_t* obtener_mesa(servidor_t* servidor, const char* id) {
+    mesa_t buscada = { (char*) id, NULL, NULL, NULL, NULL, NULL };
+    mesa_t* mesa = hash_obtener(servidor->mesas, &buscada);
+    if(mesa) return mesa;
+
+    mesa = mesa_crear(servidor, id);
+    if(!mesa) return NULL;
+    if(!hash_guardar(servidor->mesas, mesa))
+    {
+        mesa_compartida_destruir(mesa);
+        return NULL;
+    }
+    return mesa;
+}
+
+/* Una direccion que es solo digitos es un puerto TCP; si no, la ruta de un socket Unix */
+static bool es_puerto(const char* direccion) {
+    return *direccion && strspn(direccion, "0123456789") == strlen(direccion);
+}
+
+static bool poner_no_bloqueante(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+/* Abre el socket de escucha en la direccion indicada, o devuelve -1 */
+static int abrir_escucha(const char* direccion) {
+    bool puerto = es_puerto(direccion);
+    int fd = socket(puerto ? AF_INET : AF_UNIX, SOCK_STREAM, 0);
+    if(fd < 0) return -1;
+
+    int enlazado;
+    if(puerto)
+    {
+        int uno = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &uno, sizeof(uno));
+
+        struct sockaddr_in dir;
+        memset(&dir, 0, sizeof(dir));
+        dir.sin_family = AF_INET;
+        dir.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        dir.sin_port = htons((uint16_t) strtol(direccion, NULL, 10));
+        enlazado = bind(fd, (struct sockaddr*) &dir, sizeof(dir));
+    }
+    else
+    {
+        struct sockaddr_un dir;
+        if(strlen(direccion) >= sizeof(dir.sun_path)) { close(fd); return -1; }
+
+        memset(&dir, 0, sizeof(dir));
+        dir.sun_family = AF_UNIX;
+        strcpy(dir.sun_path, direccion);
+
+        // Un socket que quedo de una ejecucion anterior no deja enlazar.
+        struct stat datos;
+        if(stat(direccion, &datos) == 0 && S_ISSOCK(datos.st_mode))
+            unlink(direccion);
+        enlazado = bind(fd, (struct sockaddr*) &dir, sizeof(dir));
+    }
+
+    if(enlazado != 0 || listen(fd, CONEXIONES_EN_ESPERA) != 0 || !poner_no_bloqueante(fd))
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static bool actualizar_eventos(servidor_t* servidor, conexion_t* conexion) {
+    size_t pendiente = conexion->largo_salida - conexion->enviado;
+
+    // Mientras el cliente no lea sus respuestas no se le aceptan mas pedidos.
+    uint32_t eventos = 0;
+    if(!conexion->terminada && pendiente < SALIDA_PENDIENTE_MAXIMA && conexion->pendientes < TAREAS_PENDIENTES_MAXIMO)
+        eventos |= EPOLLIN;
+    if(pendiente) eventos |= EPOLLOUT;
+    if(eventos == conexion->eventos) return true;
+
+    struct epoll_event evento;
+    evento.events = eventos;
+    evento.data.ptr = conexion;
+    if(epoll_ctl(servidor->epoll, EPOLL_CTL_MOD, conexion->fd, &evento) != 0) return false;
+    conexion->eventos = eventos;
+    return true;
+}
+
+/* Destruye la conexion, cuya cabina ya fue liberada por su mesa */
+static void conexion_destruir(servidor_t* servidor, conexion_t* conexion) {
+    if(conexion->anterior) conexion->anterior->siguiente = conexion->siguiente;
+    else servidor->conexiones = conexion->siguiente;
+    if(conexion->siguiente) conexion->siguiente->anterior = conexion->anterior;
+
+    if(conexion->eventos) epoll_ctl(servidor->epoll, EPOLL_CTL_DEL, conexion->fd, NULL);
+    close(conexion->fd);
+
+    fclose(conexion->salida);
+    free(conexion->datos_salida);
+    free(conexion);
+}
+
+static void aceptar_conexiones(servidor_t* servidor) {
+    int fd;
+    while((fd = accept(servidor->fd, NULL, NULL)) >= 0)
+    {
+        conexion_t* conexion = malloc(sizeof(conexion_t));
+        if(!conexion || !poner_no_bloqueante(fd)) { free(conexion); close(fd); continue; }
+
+        conexion->fd = fd;
+        conexion->mesa = NULL;
+        conexion->cabina = NULL;
+        conexion->largo_entrada = 0;
+        conexion->descartando = false;
+        conexion->datos_salida = NULL;
+        conexion->largo_salida = 0;
+        conexion->enviado = 0;
+        conexion->terminada = false;
+        conexion->rota = false;
+        conexion->liberada = false;
+        conexion->pendientes = 0;
+        conexion->eventos = EPOLLIN;
+        conexion->salida = open_memstream(&conexion->datos_salida, &conexion->largo_salida);
+
+        struct epoll_event evento;
+        evento.events = EPOLLIN;
+        evento.data.ptr = conexion;
+        if(!conexion->salida || epoll_ctl(servidor->epoll, EPOLL_CTL_ADD, fd, &evento) != 0)
+        {
+            if(conexion->salida) fclose(conexion->salida);
+            free(conexion->datos_salida);
+            free(conexion);
+            close(fd);
+            continue;
+        }
+
+        conexion->anterior = NULL;
+        conexion->siguiente = servidor->conexiones;
+        if(servidor->conexiones) servidor->conexiones->anterior = conexion;
+        servidor->conexiones = conexion;
+    }
+}
+
+/* Asocia la conexion a la mesa, con un cuarto oscuro propio */
+static bool asignar_mesa(conexion_t* conexion, mesa_t* mesa) {
+    conexion->cabina = cabina_crear(mesa->maquina);
+    if(!conexion->cabina) return false;
+    conexion->mesa = mesa;
+    return true;
+}
+
+static bool es_comando_mesa(const char* linea) {
+    size_t largo_comando = strlen(COMANDO_MESA);
+    return strncmp(linea, COMANDO_MESA, largo_comando) == 0 && (linea[largo_comando] == ' ' || !linea[largo_comando]);
+}
+
+/* Encola una tarea en el trabajo de la mesa de la conexion.
+ Post: devuelve false (sin encolar nada) en caso de error. */
+static bool encolar_tarea(servidor_t* servidor, conexion_t* conexion, tipo_tarea_t tipo, const char* linea) {
+    tarea_t* tarea = malloc(sizeof(tarea_t));
+    if(!tarea) return false;
+
+    tarea->tipo = tipo;
+    tarea->conexion = conexion;
+    tarea->linea = NULL;
+    tarea->respuesta = NULL;
+    tarea->largo_respuesta = 0;
+    tarea->sin_salida = false;
+    tarea->siguiente = NULL;
+
+    if((linea && !(tarea->linea = copiar_clave(linea))) ||
+       !planificador_encolar(servidor->planificador, conexion->mesa->trabajo, tarea))
+    {
+        free(tarea->linea);
+        free(tarea);
+        return false;
+    }
+    conexion->pendientes++;
+    return true;
+}
+
+/* Ejecuta una tarea en un hilo del planificador. Solo toca la mesa (que no
+ * corre en otro hilo a la vez) y la tarea; la respuesta vuelve al hilo de
+ * epoll por la lista de terminadas. */
+static void ejecutar_tarea(void* dato, void* extra) {
+    tarea_t* tarea = dato;
+    servidor_t* servidor = extra;
+    conexion_t* conexion = tarea->conexion;
+
+    FILE* salida = open_memstream(&tarea->respuesta, &tarea->largo_respuesta);
+    salida_establecer(salida);
+
+    if(tarea->tipo == TAREA_LIBERAR)
+        cabina_destruir(conexion->cabina);
+    else if(!salida)
+        tarea->sin_salida = true; // Su respuesta iria al stdout del servidor, no al cliente.
+    else if(tarea->tipo == TAREA_LINEA_LARGA)
+        error_manager(LECTURA);
+    else if(es_comando_mesa(tarea->linea))
+        error_manager(OTRO); // Una conexion no cambia de mesa: la propia se perderia.
+    else
+        ejecutar_comando(conexion->cabina, tarea->linea);
+
+    salida_establecer(NULL);
+    if(salida) fclose(salida);
+
+    pthread_mutex_lock(&servidor->mutex_terminadas);
+    if(servidor->ultima_terminada) servidor->ultima_terminada->siguiente = tarea;
+    else servidor->terminadas = tarea;
+    servidor->ultima_terminada = tarea;
+    pthread_mutex_unlock(&servidor->mutex_terminadas);
+
+    uint64_t uno = 1;
+    if(write(servidor->aviso, &uno, sizeof(uno)) < 0) { /* El contador ya tiene un aviso pendiente */ }
+}
+
+/* Despacha una linea de la conexion: "mesa <id>" la asocia a una mesa, y
+ * el resto se encola en la mesa para ejecutarse en el planificador. */
+static void despachar_linea(servidor_t* servidor, conexion_t* conexion, char* linea, tipo_tarea_t tipo) {
+    size_t largo = strlen(linea);
+    if(largo && linea[largo-1] == '\r') linea[largo-1] = '\0';
+
+    if(!conexion->mesa && tipo == TAREA_LINEA_LARGA) { error_manager(LECTURA); return; }
+
+    if(!conexion->mesa && es_comando_mesa(linea))
+    {
+        const char* id = linea + strlen(COMANDO_MESA);
+        while(*id == ' ') id++;
+
+        mesa_t* mesa = *id ? obtener_mesa(servidor, id) : NULL;
+        if(!mesa || !asignar_mesa(conexion, mesa)) { error_manager(OTRO); return; }
+        fprintf(salida_actual(), "OK\n");
+        return;
+    }
+
+    if(!conexion->mesa)
+    {
+        mesa_t* mesa = mesa_crear(servidor, NULL);
+        if(!mesa || !asignar_mesa(conexion, mesa))
+        {
+            if(mesa) mesa_compartida_destruir(mesa);
+            error_manager(OTRO);
+            return;
+        }
+    }
+
+    if(encolar_tarea(servidor, conexion, tipo, linea)) return;
+
+    // Con tareas en curso, un error escrito aca saldria antes que sus respuestas.
+    if(!conexion->pendientes) error_manager(OTRO);
+    else fprintf(stderr, "No se pudo encolar un comando\n");
+}
+
+/* Despacha todas las lineas completas recibidas, y la ultima si el cliente cerro */
+static void despachar_entrada(servidor_t* servidor, conexion_t* conexion) {
+    // Lo que se responde aca mismo (mesa, errores) va antes que las tareas de la conexion.
+    salida_establecer(conexion->salida);
+
+    size_t inicio = 0;
+    char* salto;
+    while((salto = memchr(conexion->entrada + inicio, '\n', conexion->largo_entrada - inicio)))
+    {
+        *salto = '\0';
+        if(!conexion->descartando) despachar_linea(servidor, conexion, conexion->entrada + inicio, TAREA_COMANDO);
+        conexion->descartando = false;
+        inicio = (size_t) (salto - conexion->entrada) + 1;
+    }
+
+    conexion->largo_entrada -= inicio;
+    memmove(conexion->entrada, conexion->entrada + inicio, conexion->largo_entrada);
+
+    if(conexion->largo_entrada == ENTRADA_MAXIMA - 1)
+    {
+        // La linea no entra en el buffer: se informa y se ignora hasta su fin.
+        conexion->entrada[0] = '\0';
+        if(!conexion->descartando) despachar_linea(servidor, conexion, conexion->entrada, TAREA_LINEA_LARGA);
+        conexion->descartando = true;
+        conexion->largo_entrada = 0;
+    }
+
+    if(conexion->terminada && conexion->largo_entrada)
+    {
+        conexion->entrada[conexion->largo_entrada] = '\0';
+        if(!conexion->descartando) despachar_linea(servidor, conexion, conexion->entrada, TAREA_COMANDO);
+        conexion->largo_entrada = 0;
+    }
+
+    salida_establecer(NULL);
+    fflush(conexion->salida);
+}
+
+/* Manda lo que se pueda de las respuestas pendientes.
+ Post: devuelve false si la conexion se corto. */
+static bool enviar_salida(conexion_t* conexion) {
+    while(conexion->enviado < conexion->largo_salida)
+    {
+        ssize_t enviados = send(conexion->fd, conexion->datos_salida + conexion->enviado,
+                                conexion->largo_salida - conexion->enviado, MSG_NOSIGNAL);
+        if(enviados < 0 && errno == EINTR) continue;
+        if(enviados < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return true;
+        if(enviados < 0) return false;
+        conexion->enviado += (size_t) enviados;
+    }
+
+    // Todo enviado: se reusa el buffer desde el principio.
+    rewind(conexion->salida);
+    fflush(conexion->salida);
+    conexion->enviado = 0;
+    return true;
+}
+
+/* Lee todo lo disponible de la conexion y despacha las lineas completas.
+ Post: devuelve false si hubo un error de lectura. */
+static bool leer_conexion(servidor_t* servidor, conexion_t* conexion) {
+    while(!conexion->terminada)
+    {
+        // Un byte de reserva para terminar la ultima linea si el cliente cierra.
+        ssize_t leidos = read(conexion->fd, conexion->entrada + conexion->largo_entrada,
+                              ENTRADA_MAXIMA - 1 - conexion->largo_entrada);
+        if(leidos < 0 && errno == EINTR) continue;
+        if(leidos < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        if(leidos < 0) return false;
+
+        if(leidos == 0) conexion->terminada = true;
+        conexion->largo_entrada += (size_t) leidos;
+        despachar_entrada(servidor, conexion);
+
+        if(conexion->largo_salida - conexion->enviado >= SALIDA_PENDIENTE_MAXIMA ||
+           conexion->pendientes >= TAREAS_PENDIENTES_MAXIMO) break;
+    }
+    return true;
+}
+
+/* Si la conexion termino, encola la liberacion de su cabina y, cuando ya no
+ * quedan tareas ni respuestas por enviar, la destruye.
+ Post: devuelve false si la conexion fue destruida. */
+static bool revisar_conexion(servidor_t* servidor, conexion_t* conexion) {
+    if((conexion->terminada || conexion->rota) && !conexion->liberada)
+    {
+        conexion->liberada = true;
+        mesa_t* mesa = conexion->mesa;
+        if(mesa)
+        {
+            // Si no se puede encolar, la cabina queda sin liberar hasta el final.
+            if(!encolar_tarea(servidor, conexion, TAREA_LIBERAR, NULL))
+                fprintf(stderr, "No se pudo liberar una cabina\n");
+            // La mesa propia se destruye despues de su ultima tarea.
+            if(!mesa->id) trabajo_cerrar(mesa->trabajo, mesa_destruir, mesa);
+        }
+    }
+
+    bool enviada = conexion->rota || conexion->enviado == conexion->largo_salida;
+    if(conexion->liberada && !conexion->pendientes && enviada)
+    {
+        conexion_destruir(servidor, conexion);
+        return false;
+    }
+
+    if(!conexion->rota && !actualizar_eventos(servidor, conexion))
+    {
+        conexion->rota = true;
+        return revisar_conexion(servidor, conexion);
+    }
+    return true;
+}
+
+static void atender_conexion(servidor_t* servidor, conexion_t* conexion, uint32_t eventos) {
+    if(eventos & EPOLLERR) conexion->rota = true;
+    if(!conexion->rota && (eventos & (EPOLLIN | EPOLLHUP)) && !leer_conexion(servidor, conexion)) conexion->rota = true;
+    if(!conexion->rota && !enviar_salida(conexion)) conexion->rota = true;
+
+    // Una conexion rota ya no se escucha.
+    if(conexion->rota && conexion->eventos)
+    {
+        epoll_ctl(servidor->epoll, EPOLL_CTL_DEL, conexion->fd, NULL);
+        conexion->eventos = 0;
+    }
+    revisar_conexion(servidor, conexion);
+}
+
+/* Entrega a sus conexiones las respuestas de las tareas terminadas */
+static void entregar_terminadas(servidor_t* servidor) {
+    uint64_t avisos;
+    if(read(servidor->aviso, &avisos, sizeof(avisos)) < 0) { /* Sin avisos nuevos */ }
+
+    pthread_mutex_lock(&servidor->mutex_terminadas);
+    tarea_t* tarea = servidor->terminadas;
+    servidor->terminadas = NULL;
+    servidor->ultima_terminada = NULL;
+    pthread_mutex_unlock(&servidor->mutex_terminadas);
+
+    while(tarea)
+    {
+        tarea_t* siguiente = tarea->siguiente;
+        conexion_t* conexion = tarea->conexion;
+
+        if(!conexion->rota && tarea->sin_salida)
+        {
+            salida_establecer(conexion->salida);
+            error_manager(OTRO);
+            salida_establecer(NULL);
+            fflush(conexion->salida);
+        }
+        else if(!conexion->rota && tarea->largo_respuesta)
+        {
+            fwrite(tarea->respuesta, 1, tarea->largo_respuesta, conexion->salida);
+            fflush(conexion->salida);
+        }
+        conexion->pendientes--;
+        free(tarea->linea);
+        free(tarea->respuesta);
+        free(tarea);
+
+        // Se envia al cambiar de conexion, para juntar respuestas seguidas. Una
+        // conexion solo se destruye sin tareas pendientes, asi que ninguna
+        // tarea posterior de la lista la referencia.
+        if(!siguiente || siguiente->conexion != conexion)
+            atender_conexion(servidor, conexion, 0);
+        tarea = siguiente;
+    }
+}
+
+static bool instalar_senales(void) {
+    struct sigaction accion;
+    memset(&accion, 0, sizeof(accion));
+    sigemptyset(&accion.sa_mask);
+
+    // Sin SA_RESTART, para que epoll_wait vuelva con EINTR.
+    accion.sa_handler = pedir_terminacion;
+    if(sigaction(SIGINT, &accion, NULL) != 0 || sigaction(SIGTERM, &accion, NULL) != 0) return false;
+
+    accion.sa_handler = SIG_IGN;
+    return sigaction(SIGPIPE, &accion, NULL) == 0;
+}
+
+bool servidor_ejecutar(const char* direccion, size_t hilos, const opciones_maquina_t* opciones) {
+    servidor_t servidor;
+    servidor.opciones = opciones;
+    servidor.mesas = hash_crear(mesa_hash, mesa_iguales);
+    servidor.mesas_propias = 0;
+    servidor.conexiones = NULL;
+    servidor.terminadas = NULL;
+    servidor.ultima_terminada = NULL;
+    pthread_mutex_init(&servidor.mutex_terminadas, NULL);
+    servidor.planificador = planificador_crear(hilos, ejecutar_tarea, &servidor);
+    servidor.aviso = eventfd(0, EFD_NONBLOCK);
+    servidor.fd = abrir_escucha(direccion);
+    servidor.epoll = epoll_create1(0);
+
+    // El listener y el aviso de tareas terminadas se distinguen por su dato.
+    struct epoll_event evento;
+    evento.events = EPOLLIN;
+    evento.data.ptr = NULL;
+    struct epoll_event evento_aviso;
+    evento_aviso.events = EPOLLIN;
+    evento_aviso.data.ptr = &servidor;
+
+    bool listo = servidor.mesas && servidor.planificador && servidor.aviso >= 0 && servidor.fd >= 0 && servidor.epoll >= 0 &&
+                 epoll_ctl(servidor.epoll, EPOLL_CTL_ADD, servidor.fd, &evento) == 0 &&
+                 epoll_ctl(servidor.epoll, EPOLL_CTL_ADD, servidor.aviso, &evento_aviso) == 0 && instalar_senales();
+    if(!listo) fprintf(stderr, "No se pudo escuchar en %s\n", direccion);
+
+    struct epoll_event eventos[EVENTOS_MAXIMO];
+    while(listo && !terminar_servidor)
+    {
+        int cantidad = epoll_wait(servidor.epoll, eventos, EVENTOS_MAXIMO, -1);
+        if(cantidad < 0 && errno != EINTR) { listo = false; break; }
+
+        for(int i=0;i<cantidad;i++)
+        {
+            if(!eventos[i].data.ptr) aceptar_conexiones(&servidor);
+            else if(eventos[i].data.ptr == &servidor) entregar_terminadas(&servidor);
+            else atender_conexion(&servidor, eventos[i].data.ptr, eventos[i].events);
+        }
+    }
+
+    // Se cortan todas las conexiones, y el planificador termina lo encolado
+    // (incluida la liberacion de cabinas y mesas propias) antes de destruirse.
+    for(conexion_t* conexion = servidor.conexiones; conexion;)
+    {
+        conexion_t* siguiente = conexion->siguiente;
+        conexion->rota = true;
+        revisar_conexion(&servidor, conexion);
+        conexion = siguiente;
+    }
+    planificador_destruir(servidor.planificador);
+    if(servidor.aviso >= 0) entregar_terminadas(&servidor);
+    while(servidor.conexiones)
+        conexion_destruir(&servidor, servidor.conexiones);
+
+    if(servidor.mesas) hash_destruir(servidor.mesas, mesa_compartida_destruir);
+    if(servidor.aviso >= 0) close(servidor.aviso);
+    if(servidor.epoll >= 0) close(servidor.epoll);
+    if(servidor.fd >= 0)
+    {
+        close(servidor.fd);
+        if(!es_puerto(direccion)) unlink(direccion);
+    }
+    pthread_mutex_destroy(&servidor.mutex_terminadas);
+
+    return listo;
+}
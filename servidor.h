@@ -0,0 +1,43 @@
+#ifndef SERVIDOR_H
+#define SERVIDOR_H
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "maquina.h"
+
+/*
+ * Servidor local para muchas terminales a la vez: escucha en un socket Unix
+ * (o en un puerto TCP de loopback) y atiende todas las conexiones desde un
+ * solo hilo con epoll. Cada conexion habla el mismo protocolo de texto que
+ * stdin, con pedidos encadenados: se pueden mandar varias lineas sin esperar
+ * las respuestas, que vuelven en el mismo orden.
+ *
+ * Los comandos se ejecutan en un planificador con robo de trabajo: cada mesa
+ * es un trabajo con su cola de comandos, que se ejecutan en orden y de a uno,
+ * y los hilos libres toman mesas cargadas de otros hilos.
+ *
+ * Cada conexion se asocia a una mesa, con un cuarto oscuro propio. Con
+ * "mesa <id>" como primer comando se une a la mesa compartida <id> (la crea
+ * si no existe), para que por ejemplo la terminal de ingreso y las de varios
+ * cuartos oscuros operen sobre la misma cola, con votantes votando a la vez;
+ * las mesas compartidas viven hasta que termina el servidor. Si empieza con
+ * cualquier otro comando, la conexion tiene una mesa propia que se destruye
+ * al desconectarse.
+ *
+ * Con un segmento de resultados en las opciones, cada mesa compartida publica
+ * los suyos en <segmento>.<id>. De la misma forma, con un registro de auditoria
+ * cada mesa compartida lleva el suyo en <archivo>.<id>, y cada mesa propia en
+ * <archivo>.propia-<pid>-<n>. Una mesa cuyo registro no se puede crear no abre.
+ * El filtro del padron se nombra igual, para que ningun abrir reemplace el
+ * de otra mesa.
+ */
+
+// Atiende conexiones en direccion hasta recibir SIGINT o SIGTERM, ejecutando
+// los comandos en la cantidad de hilos indicada. Si direccion es un numero se
+// escucha en ese puerto TCP de 127.0.0.1; si no, es la ruta del socket Unix.
+// Pre: hilos > 0.
+// Post: devuelve false (informando en stderr) si no se pudo escuchar.
+bool servidor_ejecutar(const char* direccion, size_t hilos, const opciones_maquina_t* opciones);
+
+#endif // SERVIDOR_H
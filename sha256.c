@@ -0,0 +1,107 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "sha256.h"
+
+static const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+#define ROTAR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+/* Procesa un bloque de 64 bytes */
+static void comprimir(uint32_t estado[8], const uint8_t bloque[64]) {
+    uint32_t w[64];
+    for(size_t i=0;i<16;i++)
+        w[i] = (uint32_t) bloque[4*i] << 24 | (uint32_t) bloque[4*i+1] << 16 | (uint32_t) bloque[4*i+2] << 8 | bloque[4*i+3];
+    for(size_t i=16;i<64;i++)
+    {
+        uint32_t s0 = ROTAR(w[i-15], 7) ^ ROTAR(w[i-15], 18) ^ (w[i-15] >> 3);
+        uint32_t s1 = ROTAR(w[i-2], 17) ^ ROTAR(w[i-2], 19) ^ (w[i-2] >> 10);
+        w[i] = w[i-16] + s0 + w[i-7] + s1;
+    }
+
+    uint32_t a = estado[0], b = estado[1], c = estado[2], d = estado[3];
+    uint32_t e = estado[4], f = estado[5], g = estado[6], h = estado[7];
+    for(size_t i=0;i<64;i++)
+    {
+        uint32_t t1 = h + (ROTAR(e, 6) ^ ROTAR(e, 11) ^ ROTAR(e, 25)) + ((e & f) ^ (~e & g)) + K[i] + w[i];
+        uint32_t t2 = (ROTAR(a, 2) ^ ROTAR(a, 13) ^ ROTAR(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+
+    estado[0] += a; estado[1] += b; estado[2] += c; estado[3] += d;
+    estado[4] += e; estado[5] += f; estado[6] += g; estado[7] += h;
+}
+
+void sha256_iniciar(sha256_t* sha) {
+    static const uint32_t INICIAL[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    memcpy(sha->estado, INICIAL, sizeof(INICIAL));
+    sha->largo = 0;
+    sha->usado = 0;
+}
+
+void sha256_agregar(sha256_t* sha, const void* datos, size_t largo) {
+    const uint8_t* bytes = datos;
+    sha->largo += largo;
+
+    // Completar el bloque pendiente, y despues procesar directo de los datos.
+    if(sha->usado)
+    {
+        size_t copiar = 64 - sha->usado < largo ? 64 - sha->usado : largo;
+        memcpy(sha->bloque + sha->usado, bytes, copiar);
+        sha->usado += copiar;
+        bytes += copiar;
+        largo -= copiar;
+        if(sha->usado < 64) return;
+        comprimir(sha->estado, sha->bloque);
+        sha->usado = 0;
+    }
+
+    for(;largo >= 64;bytes += 64, largo -= 64)
+        comprimir(sha->estado, bytes);
+
+    memcpy(sha->bloque, bytes, largo);
+    sha->usado = largo;
+}
+
+void sha256_terminar(sha256_t* sha, uint8_t resumen[SHA256_BYTES]) {
+    uint64_t bits = sha->largo * 8;
+
+    sha->bloque[sha->usado++] = 0x80;
+    if(sha->usado > 56)
+    {
+        memset(sha->bloque + sha->usado, 0, 64 - sha->usado);
+        comprimir(sha->estado, sha->bloque);
+        sha->usado = 0;
+    }
+    memset(sha->bloque + sha->usado, 0, 56 - sha->usado);
+    for(size_t i=0;i<8;i++)
+        sha->bloque[56+i] = (uint8_t) (bits >> (56 - 8*i));
+    comprimir(sha->estado, sha->bloque);
+
+    for(size_t i=0;i<8;i++)
+    {
+        resumen[4*i] = (uint8_t) (sha->estado[i] >> 24);
+        resumen[4*i+1] = (uint8_t) (sha->estado[i] >> 16);
+        resumen[4*i+2] = (uint8_t) (sha->estado[i] >> 8);
+        resumen[4*i+3] = (uint8_t) sha->estado[i];
+    }
+}
+
+void sha256(const void* datos, size_t largo, uint8_t resumen[SHA256_BYTES]) {
+    sha256_t sha;
+    sha256_iniciar(&sha);
+    sha256_agregar(&sha, datos, largo);
+    sha256_terminar(&sha, resumen);
+}
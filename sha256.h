@@ -0,0 +1,32 @@
+#ifndef SHA256_H
+#define SHA256_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/* SHA-256 (FIPS 180-4), para los resumenes de la auditoria */
+
+#define SHA256_BYTES 32
+
+typedef struct sha256 {
+    uint32_t estado[8];
+    uint64_t largo;
+    uint8_t bloque[64];
+    size_t usado;
+} sha256_t;
+
+// Empieza un resumen nuevo.
+void sha256_iniciar(sha256_t* sha);
+
+// Agrega datos al resumen.
+// Pre: el resumen fue iniciado y no terminado.
+void sha256_agregar(sha256_t* sha, const void* datos, size_t largo);
+
+// Escribe el resumen de todo lo agregado.
+// Pre: el resumen fue iniciado. Post: hay que iniciarlo para volver a usarlo.
+void sha256_terminar(sha256_t* sha, uint8_t resumen[SHA256_BYTES]);
+
+// Resumen de un solo bloque de datos.
+void sha256(const void* datos, size_t largo, uint8_t resumen[SHA256_BYTES]);
+
+#endif // SHA256_H
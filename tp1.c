@@ -1,19 +1,29 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <stdbool.h>
-#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <unistd.h>
 
 #include "util.h"
 #include "archivos.h"
+#include "maquina.h"
+#include "servidor.h"
 
 #include "lectura.h"
 #include "parser.h"
 
-#include "cola.h"
-#include "pila.h"
 
 #include "votante_partido.h"
+#include "padron.h"
+#include "hash.h"
+#include "conteo.h"
+#include "resultados.h"
+#include "traza.h"
+#include "auditoria.h"
 
 
 /* Posibles estados de la maquina de votar */
@@ -24,64 +34,114 @@ enum {
     CMD_VOTAR,
     CMD_INICIO,
     CMD_DESHACER,
-    CMD_FIN
+    CMD_FIN,
+    CMD_INGRESAR_LOTE
 };
 
 // TODO: Se podria hacer un unico enum que tenga COMANDO, PARAM1, PARAM2. Pero queda feo.
-enum { NIL0, ENTRADA_LISTAS, ENTRADA_PADRON };
+enum { NIL0, ENTRADA_LISTAS, ENTRADA_PADRON, ENTRADA_DISPOSICION };
 enum { NIL1, ENTRADA_DOC_TIPO, ENTRADA_DOC_NUM };
 
 #define COMANDOS_CANTIDAD 4
-#define COMANDOS_PARAMETROS_MAX 2
-const char* COMANDOS[] = {"abrir","ingresar","cerrar", "votar", "inicio", "deshacer", "fin"};
+#define COMANDOS_PARAMETROS_MAX 3
+const char* COMANDOS[] = {"abrir","ingresar","cerrar", "votar", "inicio", "deshacer", "fin", "ingresar_lote"};
 
 // WARN: Experimental
 bool (*COMANDOS_FUNCIONES[COMANDOS_CANTIDAD])(maquina_votacion_t*, char* entrada[]);
 
-const char* CARGOS[] = {"Presidente", "Gobernador", "Intendente"};
 const char* mensaje_OK = {"OK"};
 
-typedef enum {
-    PRESIDENTE,
-    GOBERNADOR,
-    INTENDENTE,
-    FIN
-} cargo_t;
+#define ERRORES_CANTIDAD (COLA_NO_VACIA + 1)
 
 /* Posibles estados de la maquina de votar */
 typedef enum {
     CERRADA,
-    ABIERTA,
-    VOTACION
+    ABIERTA
 } maquina_estado;
 
+/*
+ Sesion de un votante en un cuarto oscuro, de votar inicio a votar fin.
+ Todo su estado esta aca, asi que se puede retomar en cualquier momento y
+ varias sesiones de una misma mesa pueden avanzar intercaladas.
+*/
+typedef struct voto {
+    size_t partido_id;
+    size_t cargo;
+} voto_t;
+
+PILA_VALORES(pila_votos, voto_t)
+
+typedef struct sesion_votacion {
+    // Votos elegidos hasta ahora, para poder deshacerlos
+    pila_votos_t ciclo;
+    // Cargo que se esta votando actualmente (indice en los cargos de la mesa)
+    size_t votando_cargo;
+} sesion_votacion_t;
+
+struct cabina {
+    maquina_votacion_t* maquina;
+    // Sesion en curso, o NULL si el cuarto oscuro esta libre
+    sesion_votacion_t* sesion;
+};
+
+/* Carga del padron completo, que puede hacerse en un hilo aparte */
+typedef struct carga_padron {
+    char* nombre;
+    padron_disposicion_t disposicion;
+    const char* archivo_filtro;
+    // Resultado: el padron, o NULL si fallo
+    padron_t* padron;
+    // Si fallo en segundo plano, el error a informar al comando que la espere
+    error_code error;
+} carga_padron_t;
+
 struct maquina_votacion {
     // Estado actual de la maquina
     maquina_estado estado;
     // Cola de votantes esperando
-    cola_t* cola;
+    cola_votantes_t cola;
+    // Votantes que estan en la cola, para rechazar duplicados
+    hash_t* en_cola;
     // Padron de votantes que deben votar
-    lista_t* padron;
+    padron_t* padron;
     // Listas habilitadas para ser votadas
     lista_t* listas;
-    // Ciclo donde se guardan los datos mientras un votante este votando
-    pila_t* ciclo;
-    // Cargo que se esta votando actualmente (de estar votandose)
-    cargo_t votando_cargo;
+    // Las mismas listas copiadas en un arreglo, para recorrerlas al votar
+    void** partidos;
+    // Cargos que se eligen, tomados del encabezado de las listas
+    cargos_t cargos;
+    // Votos de cada partido (por su posicion en listas) para cada cargo, en
+    // posicion * cantidad de cargos + cargo
+    conteo_t* conteo;
+    // Suma una boleta al conteo, especializada en la cantidad de cargos
+    void (*contar_boleta)(maquina_votacion_t*, const size_t* posiciones);
+    // Resultados publicados para otros procesos, si se pidieron
+    resultados_t* resultados;
+    // Registro de auditoria de las boletas contadas, si se pidio
+    auditoria_t* auditoria;
+    // Votantes que empezaron a votar desde que se abrio la mesa
+    size_t votantes;
+    // Cabina del comando que se esta ejecutando
+    cabina_t* cabina;
+    // Sesiones de votacion en curso, en todas las cabinas
+    size_t sesiones_activas;
     size_t cantidad_partidos;
+    opciones_maquina_t opciones;
+    // Hilo que esta cargando el padron, si cargando_padron
+    pthread_t hilo_padron;
+    carga_padron_t carga;
+    bool cargando_padron;
 };
 
-typedef struct voto {
-    size_t partido_id;
-    size_t cargo;
-} voto_t;
+#define PARTIDO_AUSENTE SIZE_MAX
 
 /************ PROTOTYPES ************/
-void leer_entrada(maquina_votacion_t* maquina);
+void leer_entrada(cabina_t* cabina, traza_escritor_t* traza);
 
 bool comando_abrir(maquina_votacion_t* maquina, char* entrada[]);
 
 bool comando_ingresar(maquina_votacion_t* maquina, char* entrada[]);
+void comando_ingresar_lote(maquina_votacion_t* maquina, const char* argumentos);
 
 bool comando_votar(maquina_votacion_t* maquina, char* entrada[]);
 bool comando_votar_inicio(maquina_votacion_t* maquina);
@@ -89,34 +149,203 @@ bool comando_votar_idPartido(maquina_votacion_t* maquina, char* id);
 bool comando_votar_deshacer(maquina_votacion_t* maquina);
 bool comando_votar_fin(maquina_votacion_t* maquina);
 
-void mostrar_menu_votacion(maquina_votacion_t*);
+void mostrar_menu_votacion(maquina_votacion_t*, sesion_votacion_t*);
+void contar_boleta_3(maquina_votacion_t* maquina, const size_t* posiciones);
+void contar_boleta_5(maquina_votacion_t* maquina, const size_t* posiciones);
+void contar_boleta_general(maquina_votacion_t* maquina, const size_t* posiciones);
 
 bool comando_cerrar(maquina_votacion_t* maquina, char* entrada[]);
 void cerrar_maquina(maquina_votacion_t* maquina);
+votante_t* desencolar_votante(maquina_votacion_t* maquina);
+void ejecutar_comando(cabina_t* cabina, char* linea);
 
 /************************************/
 void imprimir_mensaje_ok() {
-    printf("%s\n", mensaje_OK);
+    fprintf(salida_actual(), "%s\n", mensaje_OK);
 }
 
-/* Llama a las funciones de destruccion necesarias */
-void cerrar_maquina(maquina_votacion_t* maquina) {
-    if(maquina->padron)
-        lista_destruir(maquina->padron, votante_destruir);
-    maquina->padron = NULL;
+/*
+ Carga el padron indicado en la carga, y publica su filtro si corresponde.
+ Se usa como funcion de hilo para la carga asincronica.
+*/
+void* cargar_padron_completo(void* dato) {
+    carga_padron_t* carga = dato;
+    carga->padron = NULL;
+
+    if(carga->disposicion == PADRON_DIFERIDO)
+    {
+        // Solo se mapea el archivo: las filas se decodifican al buscarlas.
+        carga->padron = padron_abrir_diferido(carga->nombre, carga->archivo_filtro);
+        if(!carga->padron) error_manager(LECTURA);
+        return NULL;
+    }
+
+    size_t cantidad;
+    // Varios archivos separados por comas se cargan en paralelo y se unen.
+    uint64_t* claves = strchr(carga->nombre, ',') ? cargar_padrones(carga->nombre, &cantidad) : cargar_padron(carga->nombre, &cantidad);
+    if(!claves) return NULL;
+
+    carga->padron = padron_crear(claves, cantidad, carga->disposicion);
+    if(!carga->padron) { error_manager(OTRO); return NULL; }
+
+    if(carga->archivo_filtro && !padron_guardar_filtro(carga->padron, carga->archivo_filtro, firma_archivo(carga->nombre)))
+        fprintf(stderr, "No se pudo guardar el filtro del padron en %s\n", carga->archivo_filtro);
+
+    return NULL;
+}
+
+/*
+ Funcion de hilo para la carga asincronica. Los errores no se escriben en la
+ salida, donde no responderian a ningun comando: se guardan en la carga y los
+ informa esperar_padron.
+*/
+void* cargar_padron_en_segundo_plano(void* dato) {
+    carga_padron_t* carga = dato;
+
+    char* descartado = NULL;
+    size_t largo;
+    FILE* errores = open_memstream(&descartado, &largo);
+    salida_establecer(errores);
+
+    cargar_padron_completo(carga);
+    if(!carga->padron) carga->error = error_ultimo();
+
+    salida_establecer(NULL);
+    if(errores) fclose(errores);
+    free(descartado);
+    return NULL;
+}
 
+/* Destruye las listas de partidos, sus cargos y el conteo de sus votos */
+void descartar_listas(maquina_votacion_t* maquina) {
     if(maquina->listas)
         lista_destruir(maquina->listas, destruir_partido);
     maquina->listas = NULL;
+    free(maquina->partidos);
+    maquina->partidos = NULL;
+    cargos_destruir(&maquina->cargos);
+
+    conteo_destruir(maquina->conteo);
+    maquina->conteo = NULL;
+}
+
+/*
+ Crea el segmento donde se publican los resultados de la mesa, si se pidio
+ uno. No poder publicarlos no impide votar.
+*/
+void crear_resultados(maquina_votacion_t* maquina) {
+    resultados_destruir(maquina->resultados);
+    maquina->resultados = NULL;
+
+    const char* nombre = maquina->opciones.segmento_resultados;
+    if(!nombre) return;
+
+    maquina->resultados = resultados_crear(nombre, maquina->cantidad_partidos, maquina->cargos.cantidad);
+    if(!maquina->resultados)
+        fprintf(stderr, "No se pudo publicar los resultados en %s\n", nombre);
+}
+
+/*
+ Empieza el registro de auditoria de la mesa, si se pidio.
+ Post: devuelve false si se pidio y no se pudo crear (por ejemplo, porque ya
+ existe): la mesa no puede abrir sin el.
+*/
+bool crear_auditoria(maquina_votacion_t* maquina) {
+    auditoria_destruir(maquina->auditoria);
+    maquina->auditoria = NULL;
+
+    const char* nombre = maquina->opciones.archivo_auditoria;
+    if(!nombre) return true;
+
+    maquina->auditoria = auditoria_crear(nombre, maquina->cargos.cantidad);
+    if(!maquina->auditoria)
+        fprintf(stderr, "No se pudo crear el registro de auditoria %s\n", nombre);
+    return maquina->auditoria != NULL;
+}
+
+/*
+ Espera a que termine la carga del padron en segundo plano, si la hay.
+ Post: devuelve false si la carga fallo, con su error en *error para que lo
+ informe el comando que la espero, dejando la mesa cerrada y la cola vacia.
+*/
+bool esperar_padron(maquina_votacion_t* maquina, error_code* error) {
+    if(!maquina->cargando_padron) return true;
+
+    pthread_join(maquina->hilo_padron, NULL);
+    maquina->cargando_padron = false;
+    free(maquina->carga.nombre);
+    maquina->padron = maquina->carga.padron;
+    if(maquina->padron) return true;
+
+    *error = maquina->carga.error;
+
+    // Sin padron nadie de la cola va a votar en esta mesa.
+    while(!cola_votantes_esta_vacia(&maquina->cola))
+        votante_destruir(desencolar_votante(maquina));
+
+    descartar_listas(maquina);
+    if(maquina->resultados) resultados_cerrar_mesa(maquina->resultados);
+    maquina->estado = CERRADA;
+    return false;
+}
 
-    if(maquina->cola)
-        cola_destruir(maquina->cola, votante_destruir);
-    maquina->cola = NULL;
+/* Destruye el padron, esperando antes a que termine de cargarse si hace falta */
+void descartar_padron(maquina_votacion_t* maquina) {
+    // Si la carga fallo no queda ningun comando al que informarlo.
+    error_code error;
+    esperar_padron(maquina, &error);
 
-    /* Destruye la pila del ciclo de votacion */
-    if(maquina->ciclo)
-        pila_destruir(maquina->ciclo, free);
-    maquina->ciclo = NULL;
+    if(maquina->padron)
+        padron_destruir(maquina->padron);
+    maquina->padron = NULL;
+}
+
+/* Llama a las funciones de destruccion necesarias */
+void cerrar_maquina(maquina_votacion_t* maquina) {
+    descartar_padron(maquina);
+    descartar_listas(maquina);
+
+    resultados_destruir(maquina->resultados);
+    maquina->resultados = NULL;
+
+    // Sin cerrar la mesa el registro queda sin cierre, y no verifica.
+    auditoria_destruir(maquina->auditoria);
+    maquina->auditoria = NULL;
+
+    if(maquina->en_cola)
+        hash_destruir(maquina->en_cola, NULL);
+    maquina->en_cola = NULL;
+
+    while(!cola_votantes_esta_vacia(&maquina->cola))
+        votante_destruir(cola_votantes_desencolar(&maquina->cola));
+}
+
+/*
+ Encola al votante, salvo que ya este esperando en la cola.
+ Post: devuelve false, con el motivo en *error, si no fue encolado; el
+ votante sigue siendo del llamador.
+*/
+bool encolar_votante(maquina_votacion_t* maquina, votante_t* votante, error_code* error) {
+    // Los de tipos desconocidos comparten la clave del tipo: no se comparan
+    // entre si, y se rechazan al votar porque no estan en el padron.
+    if(votante_tipo_conocido(votante))
+    {
+        if(hash_pertenece(maquina->en_cola, votante))
+            { *error = VOTO_REALIZADO; return false; }
+
+        if(!hash_guardar(maquina->en_cola, votante))
+            { *error = OTRO; return false; }
+    }
+
+    cola_votantes_encolar(&maquina->cola, votante);
+    return true;
+}
+
+/* Desencola al proximo votante, sacandolo tambien del conjunto de la cola */
+votante_t* desencolar_votante(maquina_votacion_t* maquina) {
+    votante_t* votante = cola_votantes_desencolar(&maquina->cola);
+    if(votante) hash_borrar(maquina->en_cola, votante);
+    return votante;
 }
 
 /*
@@ -133,44 +362,248 @@ bool comando_abrir(maquina_votacion_t* maquina, char* entrada[]) {
     if(maquina->estado >= ABIERTA)
         return error_manager(MESA_ABIERTA);
 
-    maquina->listas = cargar_csv_en_lista(maquina, entrada[ENTRADA_LISTAS], enlistar_partido);
-    if(!maquina->listas) return false;
+    // Disposicion del indice del padron, opcional: abrir <listas> <padron> [hash|eytzinger|comprimido|diferido]
+    padron_disposicion_t disposicion = PADRON_HASH;
+    if(entrada[ENTRADA_DISPOSICION] && !padron_disposicion_desde_nombre(entrada[ENTRADA_DISPOSICION], &disposicion))
+        return error_manager(OTRO);
+
+    // El padron diferido mapea un solo archivo: no se puede unir una lista.
+    if(disposicion == PADRON_DIFERIDO && strchr(entrada[ENTRADA_PADRON], ','))
+        return error_manager(OTRO);
 
-    maquina->padron = cargar_csv_en_lista(maquina, entrada[ENTRADA_PADRON], enlistar_votante);
-    if(!maquina->padron) { lista_destruir(maquina->listas, votante_destruir); return false; }
+    maquina->listas = cargar_listas(entrada[ENTRADA_LISTAS], &maquina->cargos);
+    if(!maquina->listas) return false;
 
     maquina->cantidad_partidos = lista_largo(maquina->listas);
+    maquina->partidos = malloc((maquina->cantidad_partidos ? maquina->cantidad_partidos : 1) * sizeof(void*));
+    maquina->conteo = conteo_crear(maquina->cantidad_partidos * maquina->cargos.cantidad);
+    if(!maquina->partidos || !maquina->conteo) { descartar_listas(maquina); return error_manager(OTRO); }
+    lista_exportar(maquina->listas, maquina->partidos, maquina->cantidad_partidos);
+
+    switch(maquina->cargos.cantidad)
+    {
+        case 3: maquina->contar_boleta = contar_boleta_3; break;
+        case 5: maquina->contar_boleta = contar_boleta_5; break;
+        default: maquina->contar_boleta = contar_boleta_general; break;
+    }
+
+    carga_padron_t* carga = &maquina->carga;
+    carga->nombre = copiar_clave(entrada[ENTRADA_PADRON]);
+    carga->disposicion = disposicion;
+    carga->archivo_filtro = maquina->opciones.archivo_filtro;
+    if(!carga->nombre) { descartar_listas(maquina); return error_manager(OTRO); }
+
+    // En segundo plano: se valida ahora que los archivos existan, para responder
+    // ERROR1 como siempre; otros errores los informa el comando que la espere.
+    if(maquina->opciones.carga_asincronica && disposicion != PADRON_DIFERIDO && padrones_legibles(carga->nombre))
+    {
+        maquina->cargando_padron = pthread_create(&maquina->hilo_padron, NULL, cargar_padron_en_segundo_plano, carga) == 0;
+    }
+
+    if(!maquina->cargando_padron)
+    {
+        cargar_padron_completo(carga);
+        free(carga->nombre);
+        maquina->padron = carga->padron;
+    }
+
+    if(!maquina->padron && !maquina->cargando_padron)
+    {
+        descartar_listas(maquina);
+        return false;
+    }
+
+    // Con auditoria pedida, ninguna boleta se cuenta sin registro.
+    if(!crear_auditoria(maquina))
+    {
+        descartar_padron(maquina);
+        descartar_listas(maquina);
+        return error_manager(OTRO);
+    }
+
+    maquina->votantes = 0;
+    crear_resultados(maquina);
 	maquina->estado = ABIERTA;
 
     return true;
 }
 
 /* Crear y encolar struct votante_t. */
+/*
+ Valida un votante y lo encola, sin informar errores.
+ Post: devuelve false, con el error en *error, si no fue encolado.
+*/
+bool ingresar_votante(maquina_votacion_t* maquina, const char* doc_tipo, const char* doc_num_texto, error_code* error) {
+    if(maquina->estado == CERRADA)    { *error = MESA_CERRADA; return false; }
+    if(!doc_tipo || !doc_num_texto)   { *error = NUMERO_NEGATIVO; return false; } // Segun las pruebas
+
+    uint64_t doc_num;
+    if(!documento_numero_parsear(doc_num_texto, &doc_num) || doc_num < 1)  { *error = NUMERO_NEGATIVO; return false; }
+
+    // Los tipos se internan al cargar el padron: uno desconocido todavia puede
+    // aparecer en lo que falta cargar, y si no aparece el votante no esta empadronado.
+    if(!documento_tipo_conocido(doc_tipo) && !esperar_padron(maquina, error))
+        return false;
+
+    votante_t* votante = votante_crear(doc_tipo, doc_num);
+    if(!votante) { *error = OTRO; return false; }
+
+    #ifdef DEBUG
+    printf("Votante ingresado: %s, %llu\n", votante_doc_tipo(votante), (unsigned long long) votante_doc_num(votante));
+    #endif
+
+    // Rechazar en la puerta a quien no podria votar, sin ocupar la cola.
+    if(maquina->opciones.ingreso_estricto)
+    {
+        if(!esperar_padron(maquina, error)) { votante_destruir(votante); return false; }
+
+        size_t posicion = padron_buscar(maquina->padron, votante_clave(votante));
+        if(posicion == PADRON_AUSENTE || padron_voto_realizado(maquina->padron, posicion))
+        {
+            votante_destruir(votante);
+            *error = posicion != PADRON_AUSENTE ? VOTO_REALIZADO : NO_ENPADRONADO;
+            return false;
+        }
+    }
+
+    if( encolar_votante(maquina, votante, error) )
+        return true;
+
+    votante_destruir(votante);
+    return false;
+}
+
 bool comando_ingresar(maquina_votacion_t* maquina, char* entrada[]) {
     #ifdef DEBUG
     printf("Comando ingresar ejecutado: %s , %s \n", entrada[ENTRADA_DOC_TIPO], entrada[ENTRADA_DOC_NUM]);
     #endif
 
-    // Error handling
-    if(maquina->estado == CERRADA)              { return error_manager(MESA_CERRADA); }
-    if(!entrada[ENTRADA_DOC_TIPO] || !entrada[ENTRADA_DOC_NUM])    { return error_manager(NUMERO_NEGATIVO); } // Segun las pruebas
-    if(strtol(entrada[ENTRADA_DOC_NUM], NULL, 10) < 1)  { return error_manager(NUMERO_NEGATIVO); }
+    error_code error;
+    if(ingresar_votante(maquina, entrada[ENTRADA_DOC_TIPO], entrada[ENTRADA_DOC_NUM], &error))
+        return true;
+    return error_manager(error);
+}
+
+PILA_VALORES(numeros_entrada, size_t)
+
+/* Ingreso en lote: cuantos se encolaron y, para cada codigo de error, los
+ numeros de entrada (desde 1) que lo tuvieron */
+typedef struct ingreso_lote {
+    maquina_votacion_t* maquina;
+    size_t entradas;
+    size_t ingresados;
+    numeros_entrada_t errores[ERRORES_CANTIDAD];
+} ingreso_lote_t;
+
+void ingresar_en_lote(ingreso_lote_t* lote, const char* doc_tipo, const char* doc_num) {
+    error_code error;
+    lote->entradas++;
+    if(ingresar_votante(lote->maquina, doc_tipo, doc_num, &error))
+        lote->ingresados++;
+    else if(!numeros_entrada_apilar(&lote->errores[error], lote->entradas))
+        error_manager(error);
+}
 
-    char* doc_tipo_copia = copiar_clave(entrada[ENTRADA_DOC_TIPO]);
-    char* doc_num_copia = copiar_clave(entrada[ENTRADA_DOC_NUM]);
+/* Visitar de cargar_csv: cada registro del archivo es tipo,numero */
+bool ingresar_registro(const campo_csv_t* campos, size_t cantidad, void* extra) {
+    ingresar_en_lote(extra, cantidad > 0 ? campos[0].dato : NULL, cantidad > 1 ? campos[1].dato : NULL);
+    return true;
+}
 
-    votante_t* votante = votante_crear(doc_tipo_copia, doc_num_copia);
+/*
+ Ingresa los registros del archivo. Un error de lectura despues de algunos
+ registros no se informa aparte, que seria una segunda respuesta: queda
+ agrupado como error de la entrada que no se pudo leer.
+ Post: devuelve false (informando el error) si no se leyo ningun registro.
+*/
+bool ingresar_archivo(ingreso_lote_t* lote, const char* nombre) {
+    char* errores = NULL;
+    size_t largo = 0;
+    FILE* captura = open_memstream(&errores, &largo);
+    if(!captura) return cargar_csv(nombre, ingresar_registro, lote) || lote->entradas;
+
+    FILE* salida = salida_actual();
+    salida_establecer(captura);
+    bool leido = cargar_csv(nombre, ingresar_registro, lote);
+    error_code error = error_ultimo();
+    salida_establecer(salida);
+    fclose(captura);
+
+    if(!leido && lote->entradas)
+    {
+        if(!numeros_entrada_apilar(&lote->errores[error], lote->entradas + 1))
+            error_manager(error);
+        leido = true;
+    }
+    else
+        fwrite(errores, 1, largo, salida);
 
-    if(!votante) {  return error_manager(OTRO); free(doc_num_copia); free(doc_tipo_copia); }
+    free(errores);
+    return leido;
+}
 
+/*
+ Ingresar muchos votantes de una vez, con la misma validacion que ingresar:
+    ingresar_lote <archivo>                   csv con encabezado, como el padron
+    ingresar_lote <tipo> <numero> [<tipo> <numero> ...]
+ Los errores se informan agrupados, una linea por codigo con las entradas que
+ lo tuvieron (registros del archivo o pares de la linea, desde 1), y al final
+ OK con la cantidad de votantes encolados.
+*/
+void comando_ingresar_lote(maquina_votacion_t* maquina, const char* argumentos) {
     #ifdef DEBUG
-    printf("Votante ingresado: %s, %s\n", votante_ver_doc_tipo(votante), votante_ver_doc_num(votante));
+    printf("Comando ingresar_lote ejecutado: %s\n", argumentos);
     #endif
 
-    if( cola_encolar(maquina->cola, votante) )
-        return true;
+    if(maquina->estado == CERRADA) { error_manager(MESA_CERRADA); return; }
 
-    return error_manager(OTRO);
+    char* copia = copiar_clave(argumentos);
+    if(!copia) { error_manager(OTRO); return; }
+
+    ingreso_lote_t lote;
+    lote.maquina = maquina;
+    lote.entradas = 0;
+    lote.ingresados = 0;
+    for(size_t i=0;i<ERRORES_CANTIDAD;i++)
+        numeros_entrada_iniciar(&lote.errores[i]);
+
+    char* resto;
+    char* primera = strtok_r(copia, " ", &resto);
+    char* segunda = primera ? strtok_r(NULL, " ", &resto) : NULL;
+
+    bool leido = true;
+    if(!primera)
+        leido = error_manager(NUMERO_NEGATIVO);
+    else if(!segunda)
+        leido = ingresar_archivo(&lote, primera);
+    else
+    {
+        char* doc_tipo = primera;
+        char* doc_num = segunda;
+        while(doc_tipo)
+        {
+            ingresar_en_lote(&lote, doc_tipo, doc_num);
+            doc_tipo = doc_num ? strtok_r(NULL, " ", &resto) : NULL;
+            doc_num = doc_tipo ? strtok_r(NULL, " ", &resto) : NULL;
+        }
+    }
+    free(copia);
+
+    for(size_t i=0;i<ERRORES_CANTIDAD;i++)
+    {
+        numeros_entrada_t* entradas = &lote.errores[i];
+        if(leido && !numeros_entrada_esta_vacia(entradas))
+        {
+            fprintf(salida_actual(), "ERROR%zu:", i+1);
+            for(size_t j=0;j<entradas->cantidad;j++)
+                fprintf(salida_actual(), "%c%zu", j ? ',' : ' ', entradas->datos[j]);
+            fprintf(salida_actual(), "\n");
+        }
+        numeros_entrada_liberar(entradas);
+    }
+
+    if(leido)
+        fprintf(salida_actual(), "%s %zu\n", mensaje_OK, lote.ingresados);
 }
 
 bool comando_votar(maquina_votacion_t* maquina, char* entrada[]) {
@@ -186,7 +619,7 @@ bool comando_votar(maquina_votacion_t* maquina, char* entrada[]) {
         if( comando_votar_deshacer(maquina) )
         {
             imprimir_mensaje_ok();
-            mostrar_menu_votacion(maquina);
+            mostrar_menu_votacion(maquina, maquina->cabina->sesion);
         }
     }
     else if( strcmp(entrada[1], COMANDOS[CMD_FIN]) == 0 ) {
@@ -209,69 +642,51 @@ bool comando_votar_inicio(maquina_votacion_t* maquina) {
     #endif
     // Error handling
     if(maquina->estado == CERRADA)      { return error_manager(MESA_CERRADA); }
-    if(maquina->estado == VOTACION)     { return error_manager(OTRO); }
-    if(cola_esta_vacia(maquina->cola))  { return error_manager(NO_VOTANTES); }
+    if(maquina->cabina->sesion)         { return error_manager(OTRO); }
+    if(cola_votantes_esta_vacia(&maquina->cola))  { return error_manager(NO_VOTANTES); }
 
-    votante_t* votante_padron = NULL;
-    bool enpadronado = false;
+    // Solo se espera al padron si todavia se esta cargando.
+    error_code error;
+    if(!esperar_padron(maquina, &error)) { return error_manager(error); }
 
-    votante_t* votante_espera = cola_desencolar(maquina->cola);
+    votante_t* votante_espera = desencolar_votante(maquina);
     if(!votante_espera) return error_manager(OTRO);
 
     #ifdef DEBUG
-    printf("Votante desencolado: %s, %s\n", votante_espera->documento_tipo, votante_espera->documento_numero);
+    printf("Votante desencolado: %s, %llu\n", votante_doc_tipo(votante_espera), (unsigned long long) votante_doc_num(votante_espera));
     #endif
 
-    pila_t* ciclo_votacion = pila_crear();
-    lista_iter_t* lista_iter = lista_iter_crear(maquina->padron);
+    size_t posicion = padron_buscar(maquina->padron, votante_clave(votante_espera));
+    votante_destruir(votante_espera);
 
-    if(!ciclo_votacion || !lista_iter) {
-        if(ciclo_votacion) pila_destruir(ciclo_votacion, NULL);
-        if(lista_iter) free(lista_iter);
-        return error_manager(OTRO);
-    }
+    if(posicion == PADRON_AUSENTE || padron_voto_realizado(maquina->padron, posicion))
+        return posicion != PADRON_AUSENTE ? error_manager(VOTO_REALIZADO) : error_manager(NO_ENPADRONADO);
 
-    while(!lista_iter_al_final(lista_iter))
-    {
-        votante_padron = lista_iter_ver_actual(lista_iter);
-        if(votante_iguales(votante_padron, votante_espera))
-        {
-            enpadronado = true;
-            break;
-        }
-        lista_iter_avanzar(lista_iter);
-    }
-    lista_iter_destruir(lista_iter);
-    votante_destruir(votante_espera);
+    sesion_votacion_t* sesion = malloc(sizeof(sesion_votacion_t));
+    if(!sesion) return error_manager(OTRO);
 
-    if(!enpadronado || votante_get_voto_realizado(votante_padron))
-    {
-            pila_destruir(ciclo_votacion, NULL);
-            return enpadronado ? error_manager(VOTO_REALIZADO) : error_manager(NO_ENPADRONADO);
-    }
+    pila_votos_iniciar(&sesion->ciclo);
+    sesion->votando_cargo = 0;
 
-    votante_set_voto_realizado(votante_padron);
-    maquina->estado = VOTACION;
-    maquina->ciclo = ciclo_votacion;
-    maquina->votando_cargo = PRESIDENTE;
+    padron_registrar_voto(maquina->padron, posicion);
+    maquina->cabina->sesion = sesion;
+    maquina->sesiones_activas++;
+    maquina->votantes++;
 
-    mostrar_menu_votacion(maquina);
+    mostrar_menu_votacion(maquina, sesion);
     return true;
 }
 
-/* Imprime el nombre del partido y el postulante para el cargo especificado */
-bool imprimir_cargo(void* dato, void* extra){
-    partido_politico_t* partido = dato;
-    int* cargo = extra;
-    printf("%d: %s: %s\n", partido_id(partido), partido_nombre(partido), partido_postulantes(partido)[*cargo]);
-    return true;
-}
+/* Formatear y mostrar menu de votacion: nombre de cada partido y su postulante para el cargo */
+void mostrar_menu_votacion(maquina_votacion_t* maquina, sesion_votacion_t* sesion) {
+    size_t votando = sesion->votando_cargo;
+    fprintf(salida_actual(), "Cargo: %s\n", maquina->cargos.nombres[votando]);
 
-/* Formatear y mostrar menu de votacion */
-void mostrar_menu_votacion(maquina_votacion_t* maquina) {
-    int votando = maquina->votando_cargo;
-    printf("Cargo: %s\n", CARGOS[votando]);
-    lista_iterar(maquina->listas, imprimir_cargo, &votando);
+    for(size_t i=0;i<maquina->cantidad_partidos;i++)
+    {
+        partido_politico_t* partido = maquina->partidos[i];
+        fprintf(salida_actual(), "%d: %s: %s\n", partido_id(partido), partido_nombre(partido), partido_postulantes(partido)[votando]);
+    }
 }
 
 /*
@@ -282,7 +697,8 @@ bool comando_votar_idPartido(maquina_votacion_t* maquina, char* id) {
     #ifdef DEBUG
     printf("Comando votar idPartido ejecutado \n");
     #endif
-    if(maquina->estado < VOTACION || (maquina->votando_cargo >= FIN) )
+    sesion_votacion_t* sesion = maquina->cabina->sesion;
+    if(!sesion || (sesion->votando_cargo >= maquina->cargos.cantidad) )
         return error_manager(OTRO);
 
     long int idPartido_int = strtol(id, NULL, 10);
@@ -290,41 +706,60 @@ bool comando_votar_idPartido(maquina_votacion_t* maquina, char* id) {
     if(idPartido_int < 1 || idPartido_int > maquina->cantidad_partidos)
         return error_manager(OTRO);
 
-    voto_t* voto = malloc(sizeof(voto_t));
-
-    voto->partido_id = (size_t)strtol(id, NULL, 10);
-    voto->cargo = maquina->votando_cargo;
-
-    pila_apilar(maquina->ciclo, voto);
-    maquina->votando_cargo++;
+    voto_t voto = { (size_t) idPartido_int, sesion->votando_cargo };
+    if(!pila_votos_apilar(&sesion->ciclo, voto)) return error_manager(OTRO);
+    sesion->votando_cargo++;
 
     imprimir_mensaje_ok();
 
-    if(maquina->votando_cargo < FIN)
-        mostrar_menu_votacion(maquina);
+    if(sesion->votando_cargo < maquina->cargos.cantidad)
+        mostrar_menu_votacion(maquina, sesion);
 
     return true;
 }
 
-void destruir_voto(voto_t* voto) {
-    free(voto);
-}
+/* Termina la sesion de la cabina, descartando los votos que no se contaron */
+void terminar_sesion(cabina_t* cabina) {
+    if(!cabina->sesion) return;
 
-bool votar_partido(void* dato, void* extra) {
-    partido_politico_t* partido = dato;
-    voto_t* voto = extra;
+    pila_votos_liberar(&cabina->sesion->ciclo);
+    free(cabina->sesion);
+    cabina->sesion = NULL;
+    cabina->maquina->sesiones_activas--;
+}
 
-    if(partido_id(partido) != voto->partido_id)
-        return true;
+/* Devuelve la posicion en las listas del partido con el id, o PARTIDO_AUSENTE */
+size_t posicion_partido(maquina_votacion_t* maquina, size_t id) {
+    for(size_t posicion=0;posicion<maquina->cantidad_partidos;posicion++)
+        if(partido_id(maquina->partidos[posicion]) == id)
+            return posicion;
+    return PARTIDO_AUSENTE;
+}
 
-    #ifdef DEBUG
-    printf("Partido ID votado: %s, Cargo %zu\n", voto->partido_id, voto->cargo);
-    #endif
-    size_t* votos = partido_votos(partido)[voto->cargo];
-    (*votos)++;
-    return false;
+/*
+ Suma al conteo una boleta completa, dada para cada cargo la posicion en las
+ listas del partido votado, y la publica de una vez, para que nadie vea la
+ mitad. Con la cantidad de cargos fija al compilar (las elecciones comunes de
+ 3 y 5 cargos) el paso entre partidos es una constante y el ciclo se
+ desenrolla; la version general la lee de la mesa.
+*/
+#define DEFINIR_CONTAR_BOLETA(nombre, CANTIDAD_CARGOS) \
+void nombre(maquina_votacion_t* maquina, const size_t* posiciones) { \
+    const size_t cargos = (CANTIDAD_CARGOS); \
+    size_t contadores[CARGOS_MAXIMO]; \
+    size_t cantidad = 0; \
+    for(size_t cargo=0;cargo<cargos;cargo++) \
+        if(posiciones[cargo] != PARTIDO_AUSENTE) \
+            contadores[cantidad++] = posiciones[cargo] * cargos + cargo; \
+    conteo_sumar_varios(maquina->conteo, contadores, cantidad); \
+    if(maquina->resultados) \
+        resultados_publicar_boleta(maquina->resultados, contadores, cantidad, maquina->votantes); \
 }
 
+DEFINIR_CONTAR_BOLETA(contar_boleta_3, 3)
+DEFINIR_CONTAR_BOLETA(contar_boleta_5, 5)
+DEFINIR_CONTAR_BOLETA(contar_boleta_general, maquina->cargos.cantidad)
+
 /* Cerrar ciclo de votacion y procesar resultados */
 bool comando_votar_fin(maquina_votacion_t* maquina) {
     #ifdef DEBUG
@@ -334,26 +769,35 @@ bool comando_votar_fin(maquina_votacion_t* maquina) {
     if(maquina->estado < ABIERTA)
         return error_manager(MESA_CERRADA);
 
-    if(maquina->estado < VOTACION)
+    sesion_votacion_t* sesion = maquina->cabina->sesion;
+    if(!sesion)
         return error_manager(OTRO);
 
-    if(maquina->votando_cargo < FIN)
+    if(sesion->votando_cargo < maquina->cargos.cantidad)
         return error_manager(FALTA_VOTAR);
 
-    while(!pila_esta_vacia(maquina->ciclo))
+    // Los conteos son de toda la mesa: cada sesion los actualiza de una vez al
+    // terminar, en el fragmento del hilo que la ejecuta. La pila tiene un voto
+    // por cargo.
+    size_t posiciones[CARGOS_MAXIMO];
+    uint32_t partidos[CARGOS_MAXIMO];
+    voto_t voto;
+    while(pila_votos_desapilar(&sesion->ciclo, &voto))
     {
-        voto_t* voto = pila_desapilar(maquina->ciclo);
-        lista_iterar(maquina->listas, votar_partido, voto);
-        destruir_voto(voto);
+        #ifdef DEBUG
+        printf("Partido ID votado: %zu, Cargo %zu\n", voto.partido_id, voto.cargo);
+        #endif
+        posiciones[voto.cargo] = posicion_partido(maquina, voto.partido_id);
+        partidos[voto.cargo] = (uint32_t) voto.partido_id;
     }
+    maquina->contar_boleta(maquina, posiciones);
+    if(maquina->auditoria) auditoria_registrar(maquina->auditoria, partidos);
 
     // Reset de variables.
     #ifdef DEBUG
-    if(pila_esta_vacia(maquina->ciclo)) printf("Pila vacia\n");
+    if(pila_votos_esta_vacia(&sesion->ciclo)) printf("Pila vacia\n");
     #endif
-    pila_destruir(maquina->ciclo, free);
-    maquina->ciclo = NULL;
-    maquina->estado = ABIERTA;
+    terminar_sesion(maquina->cabina);
 
     return true;
 }
@@ -367,14 +811,15 @@ bool comando_votar_deshacer(maquina_votacion_t* maquina) {
     if(maquina->estado < ABIERTA)
         return error_manager(MESA_CERRADA);
 
-    if(maquina->estado < VOTACION)
+    sesion_votacion_t* sesion = maquina->cabina->sesion;
+    if(!sesion)
         return error_manager(OTRO);
 
-    if(maquina->votando_cargo == PRESIDENTE)
+    if(sesion->votando_cargo == 0)
         return error_manager(NO_DESHACER);
 
-    maquina->votando_cargo--;
-    destruir_voto(pila_desapilar(maquina->ciclo));
+    sesion->votando_cargo--;
+    pila_votos_desapilar(&sesion->ciclo, NULL);
 
     return true;
 }
@@ -385,37 +830,98 @@ bool comando_cerrar(maquina_votacion_t* maquina, char* entrada[]) {
     printf("Comando cerrar ejecutado\n");
     #endif
     if(maquina->estado < ABIERTA) return error_manager(OTRO);
-    if(maquina->estado > ABIERTA || !cola_esta_vacia(maquina->cola) ) return error_manager(COLA_NO_VACIA);
+    if(maquina->sesiones_activas || !cola_votantes_esta_vacia(&maquina->cola) ) return error_manager(COLA_NO_VACIA);
 
-    lista_iter_t* iter = lista_iter_crear(maquina->listas);
-    if(!iter) return error_manager(OTRO);
+    lista_iter_t iter;
+    lista_iter_iniciar(&iter, maquina->listas);
 
-    while(!lista_iter_al_final(iter))
+    for(size_t posicion=0;!lista_iter_al_final(&iter);posicion++)
     {
-        partido_politico_t* partido = lista_iter_ver_actual(iter);
-        if(!partido) { lista_iter_destruir(iter); return error_manager(OTRO); }
+        partido_politico_t* partido = lista_iter_ver_actual(&iter);
+        if(!partido) return error_manager(OTRO);
 
-        printf("%s:\n", partido_nombre(partido));
+        fprintf(salida_actual(), "%s:\n", partido_nombre(partido));
 
-        for(size_t i=0;i<partido_largo(partido);i++)
-        {
-            size_t* votos = partido_votos(partido)[i];
-            printf("%s: %zu votos\n", CARGOS[i], *votos);
-        }
+        size_t cargos = maquina->cargos.cantidad;
+        for(size_t i=0;i<cargos;i++)
+            fprintf(salida_actual(), "%s: %zu votos\n", maquina->cargos.nombres[i], conteo_total(maquina->conteo, posicion * cargos + i));
 
-        // Liberar memoria
-        destruir_partido(partido);
-        lista_iter_avanzar(iter);
+        lista_iter_avanzar(&iter);
     }
-    lista_iter_destruir(iter);
-    lista_destruir(maquina->listas, NULL);
-    maquina->listas = NULL;
+    descartar_listas(maquina);
+    if(maquina->resultados) resultados_cerrar_mesa(maquina->resultados);
+
+    if(maquina->auditoria && !auditoria_cerrar(maquina->auditoria))
+        fprintf(stderr, "No se pudo escribir el registro de auditoria\n");
+    maquina->auditoria = NULL;
 
     return false;
 }
 
-/* Leer entrada e intentar formatear comandos */
-void leer_entrada(maquina_votacion_t* maquina) {
+/* Formatear una linea de entrada y ejecutar el comando correspondiente */
+void ejecutar_comando(cabina_t* cabina, char* linea) {
+    maquina_votacion_t* maquina = cabina->maquina;
+    // Una linea vacia no tiene columnas para comparar.
+    if(!*linea) return;
+
+    // El ingreso en lote puede traer muchos votantes en la linea: no pasa por
+    // el parser de columnas.
+    size_t largo_lote = strlen(COMANDOS[CMD_INGRESAR_LOTE]);
+    if(strncmp(linea, COMANDOS[CMD_INGRESAR_LOTE], largo_lote) == 0 && (linea[largo_lote] == ' ' || !linea[largo_lote]))
+    {
+        maquina->cabina = cabina;
+        comando_ingresar_lote(maquina, linea + largo_lote);
+        maquina->cabina = NULL;
+        return;
+    }
+
+    size_t columnas = obtener_cantidad_columnas(linea, ' ');
+
+    fila_csv_t* fila = parsear_linea_csv(linea, columnas, true);
+    if(!fila) return;
+
+    // CHETISIMO.
+
+    char* entrada[COMANDOS_PARAMETROS_MAX+1];
+
+    for(size_t i=0; i<COMANDOS_PARAMETROS_MAX+1;i++)
+        entrada[i] = obtener_columna(fila, i);
+
+    for(size_t i=0;i<COMANDOS_CANTIDAD;i++)
+        if( strcmp(entrada[0], COMANDOS[i]) == 0 )
+        {
+            maquina->cabina = cabina;
+            if( (*COMANDOS_FUNCIONES[i])(maquina, entrada) )
+                imprimir_mensaje_ok();
+            maquina->cabina = NULL;
+        }
+
+    destruir_fila_csv(fila, true);
+}
+
+/*
+ Ejecutar una linea guardando en la traza cuando llego y la respuesta, que
+ tambien se escribe en stdout.
+*/
+void ejecutar_grabando(cabina_t* cabina, char* linea, traza_escritor_t* traza) {
+    uint64_t instante = traza_reloj();
+    char* respuesta = NULL;
+    size_t largo = 0;
+    FILE* salida = open_memstream(&respuesta, &largo);
+    if(!salida) { ejecutar_comando(cabina, linea); return; }
+
+    salida_establecer(salida);
+    ejecutar_comando(cabina, linea);
+    salida_establecer(NULL);
+    fclose(salida);
+
+    fwrite(respuesta, 1, largo, stdout);
+    traza_registrar(traza, instante, linea, strlen(linea), respuesta, largo);
+    free(respuesta);
+}
+
+/* Leer entrada e intentar formatear comandos, grabandolos si hay traza */
+void leer_entrada(cabina_t* cabina, traza_escritor_t* traza) {
 	bool terminar = false;
 
 	while(!terminar)
@@ -430,65 +936,174 @@ void leer_entrada(maquina_votacion_t* maquina) {
         // 5 = cantidad minima de caracteres del comando mas corto valido.
 		// if(strlen(linea) < 5) { free(linea); continue; }
 
-        size_t columnas = obtener_cantidad_columnas(linea, ' ');
-
-        fila_csv_t* fila = parsear_linea_csv(linea, columnas, true);
-        if(!fila)
-        {
-            free(linea);
-            continue;
-        }
-
-        // CHETISIMO.
-
-        char* entrada[COMANDOS_PARAMETROS_MAX+1];
-
-        for(size_t i=0; i<COMANDOS_PARAMETROS_MAX+1;i++)
-            entrada[i] = obtener_columna(fila, i);
-
-        for(size_t i=0;i<COMANDOS_CANTIDAD;i++)
-            if( strcmp(entrada[0], COMANDOS[i]) == 0 )
-                if( (*COMANDOS_FUNCIONES[i])(maquina, entrada) )
-                    imprimir_mensaje_ok();
-
-        destruir_fila_csv(fila, true);
+        if(traza)
+            ejecutar_grabando(cabina, linea, traza);
+        else
+            ejecutar_comando(cabina, linea);
         free(linea);
 	}
 }
 
-/*
- Crear maquina de votacion con respectivos TDAs
- Procesar comandos de entrada.
-*/
-int main() {
+/* Crear maquina de votacion con respectivos TDAs */
+maquina_votacion_t* maquina_crear(const opciones_maquina_t* opciones) {
     maquina_votacion_t* maquina = malloc(sizeof(maquina_votacion_t));
-    if(!maquina) return 1;
+    if(!maquina) return NULL;
 
-    cola_t* cola = cola_crear();
-    if(!cola) { free(maquina); return 2; }
+    hash_t* en_cola = hash_crear(votante_hash, votante_iguales);
+    if(!en_cola) { free(maquina); return NULL; }
 
     maquina->estado = CERRADA;
-    maquina->cola = cola;
-    maquina->ciclo = NULL;
+    cola_votantes_iniciar(&maquina->cola);
+    maquina->en_cola = en_cola;
+    maquina->cabina = NULL;
+    maquina->sesiones_activas = 0;
     maquina->listas = NULL;
+    maquina->partidos = NULL;
+    maquina->cargos.cantidad = 0;
+    maquina->conteo = NULL;
+    maquina->contar_boleta = NULL;
+    maquina->resultados = NULL;
+    maquina->auditoria = NULL;
+    maquina->votantes = 0;
     maquina->padron = NULL;
-    maquina->votando_cargo = 0;
+    maquina->opciones = *opciones;
+    maquina->cargando_padron = false;
+    return maquina;
+}
 
-    COMANDOS_FUNCIONES[CMD_ABRIR] = comando_abrir;
-    COMANDOS_FUNCIONES[CMD_INGRESAR] = comando_ingresar;
-    COMANDOS_FUNCIONES[CMD_CERRAR] = comando_cerrar;
-    COMANDOS_FUNCIONES[CMD_VOTAR] = comando_votar;
+/* Crear un cuarto oscuro de la maquina, libre */
+cabina_t* cabina_crear(maquina_votacion_t* maquina) {
+    cabina_t* cabina = malloc(sizeof(cabina_t));
+    if(!cabina) return NULL;
 
-    leer_entrada(maquina);
+    cabina->maquina = maquina;
+    cabina->sesion = NULL;
+    return cabina;
+}
 
+void cabina_destruir(cabina_t* cabina) {
+    if(!cabina) return;
+    terminar_sesion(cabina);
+    free(cabina);
+}
+
+void maquina_destruir(maquina_votacion_t* maquina) {
+    if(!maquina) return;
     cerrar_maquina(maquina);
     free(maquina);
+}
 
-	return 0;
+int imprimir_uso(const char* programa) {
+    fprintf(stderr, "Uso: %s [--ingreso-estricto] [--carga-asincronica] [--filtro-padron archivo] [--resultados segmento] [--auditoria archivo] [--servidor socket|puerto [--hilos n] | --grabar traza | --reproducir traza [--velocidad n|max]]\n"
+                    "       %s [--hilos n] --verificar registro...\n"
+                    "       %s --monitor segmento\n", programa, programa, programa);
+    return 1;
 }
 
+/*
+ Procesar comandos de entrada: de stdin para una sola mesa, o de las
+ conexiones al servidor (--servidor) para muchas.
+*/
+int main(int argc, char* argv[]) {
+    opciones_maquina_t opciones = { false, false, NULL, NULL, NULL };
+    const char* direccion_servidor = NULL;
+    const char* traza_grabar = NULL;
+    const char* traza_reproducir_nombre = NULL;
+    const char* monitor = NULL;
+    double velocidad = 1;
+    char** verificar = NULL;
+    size_t cantidad_verificar = 0;
+    long hilos = sysconf(_SC_NPROCESSORS_ONLN);
+
+    for(int i=1;i<argc;i++)
+    {
+        if(strcmp(argv[i], "--ingreso-estricto") == 0)
+            opciones.ingreso_estricto = true;
+        else if(strcmp(argv[i], "--carga-asincronica") == 0)
+            opciones.carga_asincronica = true;
+        else if(strcmp(argv[i], "--filtro-padron") == 0 && i+1 < argc)
+            opciones.archivo_filtro = argv[++i];
+        else if(strcmp(argv[i], "--resultados") == 0 && i+1 < argc)
+            opciones.segmento_resultados = argv[++i];
+        else if(strcmp(argv[i], "--servidor") == 0 && i+1 < argc)
+            direccion_servidor = argv[++i];
+        else if(strcmp(argv[i], "--hilos") == 0 && i+1 < argc && (hilos = strtol(argv[i+1], NULL, 10)) > 0)
+            i++;
+        else if(strcmp(argv[i], "--auditoria") == 0 && i+1 < argc)
+            opciones.archivo_auditoria = argv[++i];
+        else if(strcmp(argv[i], "--verificar") == 0 && i+1 < argc)
+        {
+            // El resto de los argumentos son los registros a verificar.
+            verificar = argv + i + 1;
+            cantidad_verificar = (size_t) (argc - i - 1);
+            i = argc;
+        }
+        else if(strcmp(argv[i], "--monitor") == 0 && i+1 < argc)
+            monitor = argv[++i];
+        else if(strcmp(argv[i], "--grabar") == 0 && i+1 < argc)
+            traza_grabar = argv[++i];
+        else if(strcmp(argv[i], "--reproducir") == 0 && i+1 < argc)
+            traza_reproducir_nombre = argv[++i];
+        else if(strcmp(argv[i], "--velocidad") == 0 && i+1 < argc && (strcmp(argv[i+1], "max") == 0 || (velocidad = strtod(argv[i+1], NULL)) > 0))
+            velocidad = strcmp(argv[++i], "max") == 0 ? 0 : velocidad;
+        else
+            return imprimir_uso(argv[0]);
+    }
 
+    // La traza es de la entrada por stdin: no se combina con el servidor.
+    if((direccion_servidor && (traza_grabar || traza_reproducir_nombre)) || (traza_grabar && traza_reproducir_nombre))
+        return imprimir_uso(argv[0]);
 
+    if(verificar)
+        return auditoria_verificar(verificar, cantidad_verificar, hilos > 0 ? (size_t) hilos : 1) ? 0 : 2;
 
+    // Solo lee los resultados que publica otra mesa con --resultados.
+    if(monitor)
+    {
+        if(resultados_monitorear(monitor)) return 0;
+        fprintf(stderr, "%s: no hay resultados publicados\n", monitor);
+        return 2;
+    }
 
+    COMANDOS_FUNCIONES[CMD_ABRIR] = comando_abrir;
+    COMANDOS_FUNCIONES[CMD_INGRESAR] = comando_ingresar;
+    COMANDOS_FUNCIONES[CMD_CERRAR] = comando_cerrar;
+    COMANDOS_FUNCIONES[CMD_VOTAR] = comando_votar;
 
+    int resultado = 0;
+    if(direccion_servidor)
+    {
+        resultado = servidor_ejecutar(direccion_servidor, hilos > 0 ? (size_t) hilos : 1, &opciones) ? 0 : 2;
+    }
+    else if(traza_reproducir_nombre)
+    {
+        resultado = traza_reproducir(traza_reproducir_nombre, velocidad, &opciones) ? 0 : 2;
+    }
+    else
+    {
+        traza_escritor_t* traza = NULL;
+        if(traza_grabar && !(traza = traza_crear(traza_grabar)))
+        {
+            fprintf(stderr, "%s: no se pudo crear la traza\n", traza_grabar);
+            return 2;
+        }
+
+        maquina_votacion_t* maquina = maquina_crear(&opciones);
+        cabina_t* cabina = maquina ? cabina_crear(maquina) : NULL;
+        if(!cabina) { maquina_destruir(maquina); traza_cerrar(traza); return 2; }
+
+        leer_entrada(cabina, traza);
+        cabina_destruir(cabina);
+        maquina_destruir(maquina);
+
+        if(!traza_cerrar(traza))
+        {
+            fprintf(stderr, "%s: no se pudo escribir la traza\n", traza_grabar);
+            resultado = 2;
+        }
+    }
+
+    documento_tipos_destruir();
+
+	return resultado;
+}
@@ -0,0 +1,382 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "traza.h"
+#include "contenedores.h"
+#include "maquina.h"
+#include "util.h"
+
+// Un entero de 64 bits ocupa a lo sumo 10 bytes en base 128
+#define ENTERO_BYTES_MAXIMO 10
+// Registros mas largos que esto se toman como un archivo danado
+#define CAMPO_LARGO_MAXIMO (64 * 1024 * 1024)
+
+#define TIPOS_COMANDO_MAXIMO 16
+#define TIPO_COMANDO_LARGO 24
+
+struct traza_escritor {
+    FILE* archivo;
+    uint64_t anterior;
+    bool fallo;
+};
+
+struct traza_lector {
+    FILE* archivo;
+    uint64_t instante;
+    char* linea;
+    size_t capacidad_linea;
+    char* respuesta;
+    size_t capacidad_respuesta;
+    bool fallo;
+};
+
+uint64_t traza_reloj(void) {
+    struct timespec ahora;
+    clock_gettime(CLOCK_MONOTONIC, &ahora);
+    return (uint64_t) ahora.tv_sec * 1000000000u + (uint64_t) ahora.tv_nsec;
+}
+
+
+/* ******************************************************************
+ *                          ESCRITURA
+ * *****************************************************************/
+
+static bool escribir_entero(FILE* archivo, uint64_t valor) {
+    unsigned char bytes[ENTERO_BYTES_MAXIMO];
+    size_t largo = 0;
+    do
+    {
+        bytes[largo] = valor & 0x7f;
+        valor >>= 7;
+        if(valor) bytes[largo] |= 0x80;
+        largo++;
+    } while(valor);
+    return fwrite(bytes, 1, largo, archivo) == largo;
+}
+
+traza_escritor_t* traza_crear(const char* nombre) {
+    traza_escritor_t* traza = malloc(sizeof(traza_escritor_t));
+    if(!traza) return NULL;
+
+    traza->archivo = fopen(nombre, "wb");
+    if(!traza->archivo || fwrite(TRAZA_MAGIA, 1, 4, traza->archivo) != 4)
+    {
+        if(traza->archivo) fclose(traza->archivo);
+        free(traza);
+        return NULL;
+    }
+    traza->anterior = traza_reloj();
+    traza->fallo = false;
+    return traza;
+}
+
+bool traza_registrar(traza_escritor_t* traza, uint64_t instante, const char* linea, size_t largo_linea, const char* respuesta, size_t largo_respuesta) {
+    uint64_t delta = instante > traza->anterior ? instante - traza->anterior : 0;
+    traza->anterior += delta;
+
+    bool escrito = escribir_entero(traza->archivo, delta)
+        && escribir_entero(traza->archivo, largo_linea)
+        && fwrite(linea, 1, largo_linea, traza->archivo) == largo_linea
+        && escribir_entero(traza->archivo, largo_respuesta)
+        && fwrite(respuesta, 1, largo_respuesta, traza->archivo) == largo_respuesta;
+
+    if(!escrito) traza->fallo = true;
+    return escrito;
+}
+
+bool traza_cerrar(traza_escritor_t* traza) {
+    if(!traza) return true;
+    bool escrito = !traza->fallo;
+    if(fclose(traza->archivo) != 0) escrito = false;
+    free(traza);
+    return escrito;
+}
+
+
+/* ******************************************************************
+ *                          LECTURA
+ * *****************************************************************/
+
+/* Lee un entero. Post: devuelve false al final del archivo; si se corto a la
+ mitad o es demasiado largo, ademas marca el fallo. */
+static bool leer_entero(traza_lector_t* traza, uint64_t* valor) {
+    *valor = 0;
+    for(size_t i=0;i<ENTERO_BYTES_MAXIMO;i++)
+    {
+        int byte = getc(traza->archivo);
+        if(byte == EOF)
+        {
+            if(i > 0) traza->fallo = true;
+            return false;
+        }
+        *valor |= (uint64_t) (byte & 0x7f) << (7 * i);
+        if(!(byte & 0x80)) return true;
+    }
+    traza->fallo = true;
+    return false;
+}
+
+/* Lee un campo con su largo en el buffer, agrandandolo si hace falta, y le
+ agrega un '\0' al final */
+static bool leer_campo(traza_lector_t* traza, char** buffer, size_t* capacidad, size_t* largo) {
+    uint64_t valor;
+    if(!leer_entero(traza, &valor) || valor > CAMPO_LARGO_MAXIMO)
+    {
+        traza->fallo = true;
+        return false;
+    }
+
+    if(valor + 1 > *capacidad)
+    {
+        char* nuevo = realloc(*buffer, valor + 1);
+        if(!nuevo) { traza->fallo = true; return false; }
+        *buffer = nuevo;
+        *capacidad = valor + 1;
+    }
+
+    if(fread(*buffer, 1, valor, traza->archivo) != valor)
+    {
+        traza->fallo = true;
+        return false;
+    }
+    (*buffer)[valor] = '\0';
+    *largo = valor;
+    return true;
+}
+
+traza_lector_t* traza_abrir(const char* nombre) {
+    traza_lector_t* traza = malloc(sizeof(traza_lector_t));
+    if(!traza) return NULL;
+
+    char magia[4];
+    traza->archivo = fopen(nombre, "rb");
+    if(!traza->archivo || fread(magia, 1, 4, traza->archivo) != 4 || memcmp(magia, TRAZA_MAGIA, 4) != 0)
+    {
+        if(traza->archivo) fclose(traza->archivo);
+        free(traza);
+        return NULL;
+    }
+    traza->instante = 0;
+    traza->linea = NULL;
+    traza->capacidad_linea = 0;
+    traza->respuesta = NULL;
+    traza->capacidad_respuesta = 0;
+    traza->fallo = false;
+    return traza;
+}
+
+bool traza_leer(traza_lector_t* traza, traza_registro_t* registro) {
+    uint64_t delta;
+    if(traza->fallo || !leer_entero(traza, &delta))
+        return false;
+
+    if(!leer_campo(traza, &traza->linea, &traza->capacidad_linea, &registro->largo_linea)
+        || !leer_campo(traza, &traza->respuesta, &traza->capacidad_respuesta, &registro->largo_respuesta))
+        return false;
+
+    traza->instante += delta;
+    registro->instante = traza->instante;
+    registro->linea = traza->linea;
+    registro->respuesta = traza->respuesta;
+    return true;
+}
+
+bool traza_fallo(const traza_lector_t* traza) {
+    return traza->fallo;
+}
+
+void traza_lector_destruir(traza_lector_t* traza) {
+    if(!traza) return;
+    fclose(traza->archivo);
+    free(traza->linea);
+    free(traza->respuesta);
+    free(traza);
+}
+
+
+/* ******************************************************************
+ *                        REPRODUCCION
+ * *****************************************************************/
+
+PILA_VALORES(latencias, uint64_t)
+
+/* Latencias de los comandos de un mismo tipo */
+typedef struct tipo_comando {
+    char nombre[TIPO_COMANDO_LARGO];
+    latencias_t latencias;
+} tipo_comando_t;
+
+typedef struct reproduccion {
+    tipo_comando_t tipos[TIPOS_COMANDO_MAXIMO];
+    size_t cantidad_tipos;
+    size_t comandos;
+    size_t distintas;
+    // Mayor demora en empezar un comando respecto de su instante
+    uint64_t retraso_maximo;
+} reproduccion_t;
+
+/* Escribe en nombre el tipo del comando: la primer palabra, y para votar
+ tambien la segunda, salvo que sea el id de un partido */
+static void nombre_tipo(const char* linea, char nombre[TIPO_COMANDO_LARGO]) {
+    size_t largo = strcspn(linea, " ");
+    if(!largo) { strcpy(nombre, "(vacia)"); return; }
+
+    if(largo == 5 && strncmp(linea, "votar", 5) == 0 && linea[5] == ' ')
+    {
+        const char* accion = linea + 6;
+        if(*accion >= '0' && *accion <= '9') accion = "idPartido";
+        snprintf(nombre, TIPO_COMANDO_LARGO, "votar %.*s", (int) strcspn(accion, " "), accion);
+        return;
+    }
+    snprintf(nombre, TIPO_COMANDO_LARGO, "%.*s", (int) largo, linea);
+}
+
+/* Devuelve el tipo del comando, agregandolo si es nuevo. Cuando no hay mas
+ lugar, los nuevos van todos al ultimo, "(otros)". */
+static tipo_comando_t* buscar_tipo(reproduccion_t* reproduccion, const char* linea) {
+    char nombre[TIPO_COMANDO_LARGO];
+    nombre_tipo(linea, nombre);
+
+    for(size_t i=0;i<reproduccion->cantidad_tipos;i++)
+        if(strcmp(reproduccion->tipos[i].nombre, nombre) == 0)
+            return &reproduccion->tipos[i];
+
+    if(reproduccion->cantidad_tipos == TIPOS_COMANDO_MAXIMO)
+        return &reproduccion->tipos[TIPOS_COMANDO_MAXIMO-1];
+
+    tipo_comando_t* tipo = &reproduccion->tipos[reproduccion->cantidad_tipos++];
+    strcpy(tipo->nombre, reproduccion->cantidad_tipos == TIPOS_COMANDO_MAXIMO ? "(otros)" : nombre);
+    latencias_iniciar(&tipo->latencias);
+    return tipo;
+}
+
+/* Espera hasta el instante (de traza_reloj) */
+static void esperar_hasta(uint64_t instante) {
+    struct timespec objetivo = { (time_t) (instante / 1000000000u), (long) (instante % 1000000000u) };
+    while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &objetivo, NULL) == EINTR);
+}
+
+/* Ejecuta un registro en la cabina, midiendo su latencia y comparando la
+ respuesta con la grabada */
+static bool reproducir_registro(reproduccion_t* reproduccion, cabina_t* cabina, traza_registro_t* registro) {
+    tipo_comando_t* tipo = buscar_tipo(reproduccion, registro->linea);
+
+    char* respuesta = NULL;
+    size_t largo = 0;
+    FILE* salida = open_memstream(&respuesta, &largo);
+    if(!salida) return false;
+
+    salida_establecer(salida);
+    uint64_t inicio = traza_reloj();
+    ejecutar_comando(cabina, registro->linea);
+    uint64_t latencia = traza_reloj() - inicio;
+    salida_establecer(NULL);
+    fclose(salida);
+
+    if(largo != registro->largo_respuesta || memcmp(respuesta, registro->respuesta, largo) != 0)
+        reproduccion->distintas++;
+    free(respuesta);
+
+    reproduccion->comandos++;
+    return latencias_apilar(&tipo->latencias, latencia);
+}
+
+static int comparar_latencias(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*) a, y = *(const uint64_t*) b;
+    return (x > y) - (x < y);
+}
+
+/* Latencia del percentil (por rango), en microsegundos */
+static double percentil(const latencias_t* latencias, size_t porcentaje) {
+    size_t rango = (latencias->cantidad * porcentaje + 99) / 100;
+    return (double) latencias->datos[rango ? rango - 1 : 0] / 1e3;
+}
+
+static void informar(reproduccion_t* reproduccion, double segundos) {
+    printf("%-20s %9s %10s %10s %10s %10s\n", "comando", "cantidad", "media_us", "p50_us", "p99_us", "max_us");
+
+    for(size_t i=0;i<reproduccion->cantidad_tipos;i++)
+    {
+        latencias_t* latencias = &reproduccion->tipos[i].latencias;
+        if(latencias_esta_vacia(latencias)) continue;
+        qsort(latencias->datos, latencias->cantidad, sizeof(uint64_t), comparar_latencias);
+
+        uint64_t suma = 0;
+        for(size_t j=0;j<latencias->cantidad;j++) suma += latencias->datos[j];
+
+        printf("%-20s %9zu %10.1f %10.1f %10.1f %10.1f\n", reproduccion->tipos[i].nombre, latencias->cantidad,
+            (double) suma / (double) latencias->cantidad / 1e3, percentil(latencias, 50), percentil(latencias, 99),
+            (double) latencias->datos[latencias->cantidad-1] / 1e3);
+    }
+
+    printf("%zu comandos en %.3f s, retraso maximo %.1f us, respuestas distintas a las grabadas: %zu\n",
+        reproduccion->comandos, segundos, (double) reproduccion->retraso_maximo / 1e3, reproduccion->distintas);
+}
+
+bool traza_reproducir(const char* nombre, double velocidad, const opciones_maquina_t* opciones) {
+    traza_lector_t* traza = traza_abrir(nombre);
+    if(!traza)
+    {
+        fprintf(stderr, "%s: no es una traza\n", nombre);
+        return false;
+    }
+
+    maquina_votacion_t* maquina = maquina_crear(opciones);
+    cabina_t* cabina = maquina ? cabina_crear(maquina) : NULL;
+    if(!cabina)
+    {
+        maquina_destruir(maquina);
+        traza_lector_destruir(traza);
+        fprintf(stderr, "No se pudo crear la mesa\n");
+        return false;
+    }
+
+    reproduccion_t reproduccion;
+    reproduccion.cantidad_tipos = 0;
+    reproduccion.comandos = 0;
+    reproduccion.distintas = 0;
+    reproduccion.retraso_maximo = 0;
+
+    bool ok = true;
+    traza_registro_t registro;
+    uint64_t comienzo = traza_reloj();
+
+    while(ok && traza_leer(traza, &registro))
+    {
+        if(velocidad > 0)
+        {
+            uint64_t objetivo = comienzo + (uint64_t) ((double) registro.instante / velocidad);
+            uint64_t ahora = traza_reloj();
+            if(ahora < objetivo)
+                esperar_hasta(objetivo);
+            else if(ahora - objetivo > reproduccion.retraso_maximo)
+                reproduccion.retraso_maximo = ahora - objetivo;
+        }
+        ok = reproducir_registro(&reproduccion, cabina, &registro);
+    }
+    double segundos = (double) (traza_reloj() - comienzo) / 1e9;
+
+    if(!ok)
+        fprintf(stderr, "Sin memoria para reproducir la traza\n");
+    else if(traza_fallo(traza))
+    {
+        fprintf(stderr, "%s: traza danada despues de %zu comandos\n", nombre, reproduccion.comandos);
+        ok = false;
+    }
+
+    cabina_destruir(cabina);
+    maquina_destruir(maquina);
+    traza_lector_destruir(traza);
+
+    informar(&reproduccion, segundos);
+    for(size_t i=0;i<reproduccion.cantidad_tipos;i++)
+        latencias_liberar(&reproduccion.tipos[i].latencias);
+    return ok;
+}
@@ -0,0 +1,85 @@
+#ifndef TRAZA_H
+#define TRAZA_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "maquina.h"
+
+/* ******************************************************************
+ *                DEFINICION DE LOS TIPOS DE DATOS
+ * *****************************************************************/
+
+/* Traza de una sesion por stdin: cada linea de entrada con el instante en que
+ * llego (reloj monotono) y la respuesta que se emitio, para reproducirla mas
+ * tarde con la misma forma de carga.
+ *
+ * Formato binario: la cabecera TRAZA_MAGIA (4 bytes) y despues un registro
+ * por linea, con tres enteros sin signo en base 128 (7 bits por byte, el bit
+ * alto indica que sigue otro byte, el menos significativo primero):
+ *     nanosegundos desde el registro anterior (o desde que se creo la traza)
+ *     largo de la linea, seguido de la linea sin el fin de linea
+ *     largo de la respuesta, seguido de la respuesta */
+
+#define TRAZA_MAGIA "TRZ1"
+
+typedef struct traza_escritor traza_escritor_t;
+typedef struct traza_lector traza_lector_t;
+
+/* Registro leido de una traza. Las cadenas son del lector y valen hasta la
+ * proxima lectura; la linea termina en '\0' y se puede modificar. */
+typedef struct traza_registro {
+    // Nanosegundos desde que se creo la traza
+    uint64_t instante;
+    char* linea;
+    size_t largo_linea;
+    char* respuesta;
+    size_t largo_respuesta;
+} traza_registro_t;
+
+
+/* ******************************************************************
+ *                         PRIMITIVAS
+ * *****************************************************************/
+
+// Devuelve el reloj monotono en nanosegundos.
+uint64_t traza_reloj(void);
+
+// Crea (o vacia) el archivo de traza nombre. Los instantes se cuentan desde aca.
+// Post: devuelve NULL en caso de error.
+traza_escritor_t* traza_crear(const char* nombre);
+
+// Agrega un registro con la linea recibida en el instante indicado (de
+// traza_reloj) y su respuesta.
+// Pre: la traza fue creada; los instantes no decrecen.
+// Post: devuelve false si no se pudo escribir.
+bool traza_registrar(traza_escritor_t* traza, uint64_t instante, const char* linea, size_t largo_linea, const char* respuesta, size_t largo_respuesta);
+
+// Cierra el archivo, escribiendo lo pendiente.
+// Post: devuelve false si no se pudo escribir todo.
+bool traza_cerrar(traza_escritor_t* traza);
+
+// Abre una traza para leerla.
+// Post: devuelve NULL si no existe o no es una traza.
+traza_lector_t* traza_abrir(const char* nombre);
+
+// Lee el proximo registro.
+// Pre: la traza fue abierta.
+// Post: devuelve false al llegar al final o si el archivo esta truncado o
+// danado (ver traza_fallo).
+bool traza_leer(traza_lector_t* traza, traza_registro_t* registro);
+
+// Devuelve true si alguna lectura encontro un registro invalido.
+bool traza_fallo(const traza_lector_t* traza);
+
+void traza_lector_destruir(traza_lector_t* traza);
+
+// Reproduce la traza nombre en una mesa nueva, creada con las opciones dadas,
+// respetando los instantes divididos por la velocidad (0 es lo mas rapido
+// posible). Compara cada respuesta con la grabada e informa en stdout la
+// latencia por tipo de comando.
+// Post: devuelve false (informando en stderr) si la traza no se pudo leer entera.
+bool traza_reproducir(const char* nombre, double velocidad, const opciones_maquina_t* opciones);
+
+#endif // TRAZA_H
@@ -1,11 +1,33 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdbool.h>
 #include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "util.h"
 
+/* Salida de los mensajes del hilo actual (NULL: stdout) */
+static __thread FILE* salida;
+// Ultimo codigo informado por error_manager en cada hilo
+static __thread error_code ultimo_error = OTRO;
+
+void salida_establecer(FILE* archivo) {
+    salida = archivo;
+}
+
+FILE* salida_actual(void) {
+    return salida ? salida : stdout;
+}
+
+error_code error_ultimo(void) {
+    return ultimo_error;
+}
 
 /* Imprime codigo de error */
-bool error_manager(int code) {
+bool error_manager(error_code code) {
     /*
     ERROR1: si hubo un error en la lectura de los archivos (o archivos inexistentes).
     ERROR2: si la mesa ya estaba previamente abierta
@@ -19,17 +41,39 @@ bool error_manager(int code) {
     ERROR10: en cualquier otro caso no contemplado.
     ERROR11: En caso de que aún queden votantes ingresados sin emitir su voto
     */
-    printf("ERROR%d\n", code+1);
+    ultimo_error = code;
+    fprintf(salida_actual(), "ERROR%d\n", code+1);
     return false;
 }
 
 /* Copia la clave en memoria */
 char* copiar_clave(const char *clave) {
     char* clave_copiada = malloc(sizeof(char) * strlen(clave)+1);
+    if(!clave_copiada) return NULL;
     strcpy(clave_copiada, clave);
     return clave_copiada;
 }
 
+/* Escribe el archivo en un temporal del mismo directorio y lo pone en su lugar de una vez */
+bool archivo_reemplazar(const char* nombre, bool (*escribir)(FILE* archivo, const void* dato), const void* dato) {
+    char* temporal = malloc(strlen(nombre) + sizeof(".XXXXXX"));
+    if(!temporal) return false;
+    sprintf(temporal, "%s.XXXXXX", nombre);
+
+    int fd = mkstemp(temporal);
+    FILE* archivo = fd >= 0 ? fdopen(fd, "wb") : NULL;
+    if(fd >= 0 && !archivo) close(fd);
+
+    // mkstemp lo crea solo para el duenio: el archivo se comparte con otros procesos.
+    bool escrito = archivo && fchmod(fd, 0644) == 0 && escribir(archivo, dato) && fflush(archivo) == 0 && fsync(fd) == 0;
+    if(archivo && fclose(archivo) != 0) escrito = false;
+
+    if(escrito) escrito = rename(temporal, nombre) == 0;
+    if(fd >= 0 && !escrito) unlink(temporal);
+    free(temporal);
+    return escrito;
+}
+
 /* Obtiene cantidad de columnas de una cadena, separadas por el parametro separador */
 size_t obtener_cantidad_columnas(char* cadena, char separador) {
     char* caracter = cadena;
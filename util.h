@@ -2,6 +2,7 @@
 #define UTIL_H
 
 #include <stdbool.h>
+#include <stdio.h>
 #include <string.h>
 
 /* Codigos de error escritos user-friendly*/
@@ -19,11 +20,24 @@ typedef enum {
     COLA_NO_VACIA
 } error_code;
 
+/* Cambia la salida de los mensajes (y errores) del hilo actual; NULL vuelve a stdout */
+void salida_establecer(FILE* archivo);
+/* Devuelve la salida de los mensajes del hilo actual */
+FILE* salida_actual(void);
+
 /* Imprime codigo de error */
 bool error_manager(error_code code);
+/* Devuelve el ultimo codigo informado por error_manager en el hilo actual, u OTRO si no informo ninguno */
+error_code error_ultimo(void);
 /* Copia la clave en memoria */
 char* copiar_clave(const char *clave);
 
+/* Escribe el archivo nombre con escribir en un temporal del mismo directorio,
+ y con todo en disco lo pone en lugar del anterior: quien tenga mapeado el
+ anterior lo sigue viendo entero, y nadie ve uno a medio escribir.
+ Post: devuelve false, sin tocar nombre, si escribir o alguna operacion fallo. */
+bool archivo_reemplazar(const char* nombre, bool (*escribir)(FILE* archivo, const void* dato), const void* dato);
+
 /* Obtiene cantidad de columnas de una cadena, separadas por el parametro separador */
 size_t obtener_cantidad_columnas(char* cadena, char separador);
 
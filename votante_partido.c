@@ -1,66 +1,189 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdbool.h>
+#include <stdint.h>
+#include <ctype.h>
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "contenedores.h"
+
 /* Struct para almacenar los votantes en el padron y la cola */
 typedef struct votante {
-    char* documento_tipo;
-    char* documento_numero;
-    bool voto_realizado;
+    // Tipo de documento (8 bits altos) y numero (56 bits bajos)
+    uint64_t documento;
+    // Siguiente votante en la cola de la mesa
+    struct votante* siguiente;
 } votante_t;
 
+COLA_INTRUSIVA_DECLARAR(cola_votantes, votante_t)
+COLA_INTRUSIVA_DEFINIR(cola_votantes, votante_t, siguiente)
+
 /* Struct para almacenar los votos que reciba un determinado partido politico */
 typedef struct partido_politico {
     size_t id;
     char* nombre;
     char** postulantes;
-    size_t** votos;
     size_t largo;
 } partido_politico_t;
 
-votante_t* votante_crear(char* doc_tipo, char* doc_num) {
+#define DOCUMENTO_NUMERO_BITS 56
+#define DOCUMENTO_NUMERO_MAXIMO ((UINT64_C(1) << DOCUMENTO_NUMERO_BITS) - 1)
+// El ultimo id queda para los tipos que no estan en ningun padron.
+#define DOCUMENTO_TIPOS_MAXIMO 255
+#define DOCUMENTO_TIPO_DESCONOCIDO DOCUMENTO_TIPOS_MAXIMO
+
+/* Tipos de documento internados: el id de un tipo es su posicion. Solo se
+ internan los tipos de los padrones, que pueden estar cargandose en otro hilo
+ mientras se ingresan votantes. */
+static char* documento_tipos[DOCUMENTO_TIPOS_MAXIMO];
+// Hash de cada tipo, que a diferencia del id es el mismo en todos los procesos
+static uint64_t documento_tipos_hash[DOCUMENTO_TIPOS_MAXIMO];
+static size_t documento_tipos_cantidad = 0;
+static pthread_mutex_t documento_tipos_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* Devuelve el id del tipo de documento. Si es nuevo y internar es true lo agrega.
+ Post: devuelve false si no esta (o no hay lugar para mas tipos). */
+static bool documento_tipo_id(const char* tipo, bool internar, uint64_t* id) {
+    bool encontrado = false;
+    pthread_mutex_lock(&documento_tipos_mutex);
+
+    for(size_t i=0;i<documento_tipos_cantidad && !encontrado;i++)
+        if(strcmp(documento_tipos[i], tipo) == 0) { *id = i; encontrado = true; }
+
+    char* copia = NULL;
+    if(!encontrado && internar && documento_tipos_cantidad < DOCUMENTO_TIPOS_MAXIMO && (copia = malloc(strlen(tipo)+1)))
+    {
+        strcpy(copia, tipo);
+        // FNV-1a
+        uint64_t hash = UINT64_C(0xcbf29ce484222325);
+        for(const char* c=tipo;*c;c++)
+            hash = (hash ^ (unsigned char) *c) * UINT64_C(0x100000001b3);
+        documento_tipos_hash[documento_tipos_cantidad] = hash;
+        *id = documento_tipos_cantidad;
+        documento_tipos[documento_tipos_cantidad++] = copia;
+        encontrado = true;
+    }
+
+    pthread_mutex_unlock(&documento_tipos_mutex);
+    return encontrado;
+}
+
+void documento_tipos_destruir(void) {
+    for(size_t i=0;i<documento_tipos_cantidad;i++)
+        free(documento_tipos[i]);
+    documento_tipos_cantidad = 0;
+}
+
+bool documento_numero_parsear(const char* cadena, uint64_t* numero) {
+    const char* c = cadena;
+    uint64_t valor = 0;
+
+    if(!isdigit((unsigned char) *c)) return false;
+    while(isdigit((unsigned char) *c))
+    {
+        valor = valor * 10 + (uint64_t) (*c++ - '0');
+        if(valor > DOCUMENTO_NUMERO_MAXIMO) return false;
+    }
+    // Se toleran espacios al final, como el \r de un csv de Windows.
+    while(isspace((unsigned char) *c)) c++;
+    if(*c) return false;
+
+    *numero = valor;
+    return true;
+}
+
+bool documento_tipo_conocido(const char* doc_tipo) {
+    uint64_t tipo;
+    return documento_tipo_id(doc_tipo, false, &tipo);
+}
+
+/* Arma la clave; el tipo se busca, o se interna si internar es true */
+static bool documento_clave_armar(const char* doc_tipo, uint64_t doc_num, bool internar, uint64_t* clave) {
+    uint64_t tipo;
+    if(!doc_tipo || doc_num > DOCUMENTO_NUMERO_MAXIMO || !documento_tipo_id(doc_tipo, internar, &tipo))
+        return false;
+    *clave = (tipo << DOCUMENTO_NUMERO_BITS) | doc_num;
+    return true;
+}
+
+bool documento_clave(const char* doc_tipo, uint64_t doc_num, uint64_t* clave) {
+    return documento_clave_armar(doc_tipo, doc_num, false, clave);
+}
+
+bool documento_clave_internar(const char* doc_tipo, uint64_t doc_num, uint64_t* clave) {
+    return documento_clave_armar(doc_tipo, doc_num, true, clave);
+}
+
+size_t documento_hash(uint64_t clave) {
+    // Multiplicativo de Fibonacci: los numeros de documento son casi consecutivos.
+    uint64_t x = clave * UINT64_C(0x9e3779b97f4a7c15);
+    return (size_t) (x ^ (x >> 29));
+}
+
+uint64_t documento_huella(uint64_t clave) {
+    uint64_t tipo = clave >> DOCUMENTO_NUMERO_BITS;
+    uint64_t hash_tipo = tipo == DOCUMENTO_TIPO_DESCONOCIDO ? 0 : documento_tipos_hash[tipo];
+    return hash_tipo ^ (clave & DOCUMENTO_NUMERO_MAXIMO) * UINT64_C(0x9e3779b97f4a7c15);
+}
+
+votante_t* votante_crear(const char* doc_tipo, uint64_t doc_num) {
+    uint64_t clave;
+    if(!doc_tipo || doc_num > DOCUMENTO_NUMERO_MAXIMO)
+        return NULL;
+    // Un tipo que no tiene ningun padron no se interna: ese votante no esta empadronado.
+    if(!documento_clave(doc_tipo, doc_num, &clave))
+        clave = ((uint64_t) DOCUMENTO_TIPO_DESCONOCIDO << DOCUMENTO_NUMERO_BITS) | doc_num;
+
     votante_t* votante = malloc(sizeof(votante_t));
     if(!votante) return NULL;
-    votante->documento_tipo = doc_tipo;
-    votante->documento_numero = doc_num;
-    votante->voto_realizado = false;
+    votante->documento = clave;
+    votante->siguiente = NULL;
     return votante;
 }
 
-char* votante_doc_tipo(votante_t* votante) {
-    return votante->documento_tipo;
+const char* documento_clave_tipo(uint64_t clave) {
+    uint64_t tipo = clave >> DOCUMENTO_NUMERO_BITS;
+    return tipo == DOCUMENTO_TIPO_DESCONOCIDO ? "?" : documento_tipos[tipo];
 }
 
-char* votante_doc_num(votante_t* votante) {
-    return votante->documento_numero;
+uint64_t documento_clave_numero(uint64_t clave) {
+    return clave & DOCUMENTO_NUMERO_MAXIMO;
 }
 
-bool votante_get_voto_realizado(votante_t* votante) {
-    return votante->voto_realizado;
+const char* votante_doc_tipo(votante_t* votante) {
+    return documento_clave_tipo(votante->documento);
 }
 
-void votante_set_voto_realizado(votante_t* votante) {
-    votante->voto_realizado = true;
+uint64_t votante_doc_num(votante_t* votante) {
+    return documento_clave_numero(votante->documento);
 }
 
-/* Destruye la lista del padron y sus elementos */
+uint64_t votante_clave(const votante_t* votante) {
+    return votante->documento;
+}
+
+bool votante_tipo_conocido(const votante_t* votante) {
+    return votante->documento >> DOCUMENTO_NUMERO_BITS != DOCUMENTO_TIPO_DESCONOCIDO;
+}
+
+/* Destruye un votante */
 void votante_destruir(void* dato) {
-    votante_t* votante = dato;
-    if(!votante) return;
+    free(dato);
+}
 
-    // Liberar memoria
-    free(votante->documento_tipo);
-    free(votante->documento_numero);
-    free(votante);
+bool votante_iguales(const void* a, const void* b) {
+    return ((const votante_t*) a)->documento == ((const votante_t*) b)->documento;
 }
 
-bool votante_iguales(votante_t* a, votante_t* b) {
-    return ( strcmp(a->documento_numero, b->documento_numero) == 0 && strcmp(a->documento_tipo, b->documento_tipo) == 0 );
+size_t votante_hash(const void* dato) {
+    return documento_hash(((const votante_t*) dato)->documento);
 }
 
 /* ======================================================= */
 
-partido_politico_t* partido_crear(size_t id, char* nombre, char** postulantes, size_t** votos, size_t largo) {
+partido_politico_t* partido_crear(size_t id, char* nombre, char** postulantes, size_t largo) {
 
     partido_politico_t* partido = malloc(sizeof(partido_politico_t));
     if(!partido) return NULL;
@@ -68,7 +191,6 @@ partido_politico_t* partido_crear(size_t id, char* nombre, char** postulantes, s
     partido->id = id;
     partido->nombre = nombre;
     partido->postulantes = postulantes;
-    partido->votos = votos;
     partido->largo = largo;
 
     #ifdef DEBUG
@@ -90,10 +212,6 @@ char** partido_postulantes(partido_politico_t* partido) {
     return partido->postulantes;
 }
 
-size_t** partido_votos(partido_politico_t* partido) {
-    return partido->votos;
-}
-
 size_t partido_largo(partido_politico_t* partido) {
     return partido->largo;
 }
@@ -110,12 +228,8 @@ void destruir_partido(void* dato) {
     // Liberar memoria
     free(partido->nombre);
     for(size_t i=0;i<partido->largo;i++)
-    {
         free(partido->postulantes[i]);
-        free(partido->votos[i]);
-    }
 
     free(partido->postulantes);
-    free(partido->votos);
     free(partido);
 }
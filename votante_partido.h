@@ -2,29 +2,87 @@
 #define VOTANTE_PARTIDO_H
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 
+#include "contenedores.h"
+
 /* Struct para almacenar los votantes en el padron y la cola */
 typedef struct votante votante_t;
 
+/* Cola de votantes enlazados por un campo del propio votante: encolar no
+ reserva memoria. Ver COLA_INTRUSIVA_DECLARAR en contenedores.h. */
+COLA_INTRUSIVA_DECLARAR(cola_votantes, votante_t)
+
 /* Struct para almacenar los votos que reciba un determinado partido politico */
 typedef struct partido_politico partido_politico_t;
 
-votante_t* votante_crear(char* doc_tipo, char* doc_num);
+#define CARGOS_MAXIMO 8
+
+/* Cargos que se eligen en la mesa, en el orden de las columnas del archivo
+ de listas. Cada partido tiene un postulante por cargo. */
+typedef struct cargos {
+    size_t cantidad;
+    char* nombres[CARGOS_MAXIMO];
+} cargos_t;
+
+/* Crea un votante a partir del tipo y el numero de documento ya parseado
+ con documento_numero_parsear. No interna el tipo: si no es de ningun padron
+ cargado, el votante no se encuentra en ninguno. No toma posesion de la cadena.
+ Post: devuelve NULL si el numero no entra en la clave o en caso de error. */
+votante_t* votante_crear(const char* doc_tipo, uint64_t doc_num);
+
+const char* votante_doc_tipo(votante_t*);
+
+uint64_t votante_doc_num(votante_t*);
+
+/* Tipo y numero de documento empaquetados en una clave de 64 bits */
+uint64_t votante_clave(const votante_t*);
 
-char* votante_doc_tipo(votante_t*);
+/* Devuelve si el tipo de documento del votante es de algun padron cargado */
+bool votante_tipo_conocido(const votante_t*);
 
-char* votante_doc_num(votante_t*);
+/* Parsea un numero de documento decimal.
+ Post: devuelve false si no es un numero valido. */
+bool documento_numero_parsear(const char* cadena, uint64_t* numero);
 
-bool votante_get_voto_realizado();
+/* Empaqueta tipo y numero de documento en una clave de 64 bits.
+ Post: devuelve false si el tipo no fue internado por la carga de un padron,
+ o si el numero no entra en la clave. */
+bool documento_clave(const char* doc_tipo, uint64_t doc_num, uint64_t* clave);
 
-void votante_set_voto_realizado(votante_t*);
+/* Como documento_clave, internando el tipo si es nuevo. Solo para cargar padrones.
+ Post: devuelve false si el numero no entra en la clave, si no hay lugar para
+ mas tipos o en caso de error. */
+bool documento_clave_internar(const char* doc_tipo, uint64_t doc_num, uint64_t* clave);
 
-bool votante_iguales(votante_t*, votante_t*);
+/* Devuelve si el tipo de documento fue internado por la carga de un padron */
+bool documento_tipo_conocido(const char* doc_tipo);
+
+/* Tipo y numero de documento de una clave armada con documento_clave */
+const char* documento_clave_tipo(uint64_t clave);
+uint64_t documento_clave_numero(uint64_t clave);
+
+/* Hash de una clave de documento */
+size_t documento_hash(uint64_t clave);
+
+/* Hash de 64 bits del tipo (como cadena) y el numero de documento de la clave.
+ A diferencia de la clave, no depende del orden en que el proceso interno los
+ tipos: sirve para datos que comparten procesos distintos. */
+uint64_t documento_huella(uint64_t clave);
+
+/* Libera los tipos de documento internados por la carga de los padrones */
+void documento_tipos_destruir(void);
+
+/* Compara dos votante_t por tipo y numero de documento */
+bool votante_iguales(const void*, const void*);
+
+/* Hash de un votante_t, coherente con votante_iguales */
+size_t votante_hash(const void*);
 
 /* ========================================== */
 
-partido_politico_t* partido_crear(size_t, char*, char**, size_t**, size_t);
+partido_politico_t* partido_crear(size_t, char*, char**, size_t);
 
 void votante_destruir(void* dato);
 
@@ -34,8 +92,6 @@ char* partido_nombre(partido_politico_t*);
 
 char** partido_postulantes(partido_politico_t*);
 
-size_t** partido_votos(partido_politico_t*);
-
 size_t partido_largo(partido_politico_t*);
 
 bool partido_iguales(partido_politico_t*, partido_politico_t*);